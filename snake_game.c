@@ -1,22 +1,153 @@
 #include "raylib.h"
+#include "rlgl.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
 #include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdatomic.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#endif
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 #define GRID_SIZE 20
-#define SNAKE_MAX_LENGTH 100
+#define SNAKE_MAX_LENGTH BOARD_CELLS  // A snake may grow until it fills the board
+#define BODY_CHUNK_CELLS 64  // Body storage grows in chunks of this many cells
+#define BODY_CHUNKS 32  // Power of two; a board-filling snake spans at most 19 chunks
 #define BASE_SPEED 100  // Base speed in milliseconds
 #define TIME_ATTACK_DURATION 60  // Duration in seconds for Time Attack mode
 #define PHANTOM_WALL_INTERVAL 5.0  // Seconds between phantom wall appearances
 #define PHANTOM_WALL_DURATION 3.0  // Seconds the phantom wall stays active
+#define PHANTOM_WALL_MIN_INTERVAL 1.5  // Fastest wall spawn rate a wall-ramp tuning can reach
+#define MAX_SPEED_STEP 30  // Largest speed-up per pickup a tuning may ask for; keeps the move time positive
+#define DEFAULT_TUNING { BASE_SPEED, { 2, 5, 5, 2, 2 }, 10, PHANTOM_WALL_INTERVAL, PHANTOM_WALL_DURATION, \
+                         TIME_ATTACK_DURATION, { 1, 1, 1, 1, 2 }, 1, 0, 1, 0 }
+#define MAX_PHANTOM_WALLS 8  // Pool capacity; one wall is up at a time unless tuned otherwise
+#define PHANTOM_WALL_MAX_CELLS 16  // Walls are at most 12 cells long
+#define MAX_PICKUPS 64  // Food and golden fruit pool
+#define MAX_GOLDEN_FRUITS 16  // Most golden fruit a tuning may keep on the board
 #define NAV_BAR_HEIGHT 80  // Height of the navigation/status bar
 #define COUNTDOWN_DURATION 3.0f  // Duration of the countdown animation (3 seconds)
+#define BENCH_GAME_MOVES 3000  // Longest game --bench plays before starting a new one
+#define MAX_PARTICLES 65536  // Shared effect pool, no allocation per effect
+#define PARTICLE_BATCH 2048  // Quads submitted per rlgl batch check
+#define PARTICLE_GRAVITY 240.0f  // Pixels per second squared
+#define PARTICLE_DRAG 1.5f  // Fraction of velocity lost per second
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_BUFFER_FRAMES 128  // Stream sub-buffer, about 2.7 ms
+#define AUDIO_MIX_CHUNK 1024  // Frames mixed per pass inside one callback
+#define AUDIO_QUEUE_SIZE 256  // Command ring between game and audio thread (power of two)
+#define AUDIO_MAX_VOICES 24
+#define CAPTURE_QUEUE_FRAMES 8  // Frames waiting for the encoder (power of two); more are dropped
+#define CAPTURE_VIDEO_FPS 60  // Recordings are stamped at this rate whatever the display reaches
+#define BOARD_COLS (SCREEN_WIDTH / GRID_SIZE)  // Playfield below the nav bar, in cells
+#define BOARD_ROWS ((SCREEN_HEIGHT - NAV_BAR_HEIGHT) / GRID_SIZE)
+#define BOARD_CELLS (BOARD_COLS * BOARD_ROWS)
+#define BOARD_CHANGES_MAX 256  // Changed cells remembered between board uploads; more forces a full rebuild
+#define REACH_LABELS (BOARD_CELLS * 4 + 1)  // Region labels handed out before the board is relabelled
+#define ARENA_WIDTH 512  // Arena board width in cells
+#define ARENA_HEIGHT 512  // Arena board height in cells
+#define ARENA_CELLS (ARENA_WIDTH * ARENA_HEIGHT)
+#define ARENA_AI_SNAKES 256  // AI snakes sharing the arena with the player
+#define ARENA_MAX_SNAKES (ARENA_AI_SNAKES + 1)  // Slot 0 is the player
+#define ARENA_SNAKE_MAX_LENGTH 256  // Ring buffer capacity per arena snake (power of two)
+#define ARENA_START_LENGTH 3
+#define ARENA_FOOD_CAPACITY 4096  // Shared food pool size
+#define ARENA_FOOD_TARGET 1536  // Food kept on the board by random spawns
+#define ARENA_FOOD_SPAWNS_PER_TICK 32
+#define ARENA_TICK_MS 80  // Fixed arena tick in milliseconds
+#define ARENA_MAX_TICKS_PER_FRAME 4  // Catch-up limit after a long frame
+#define ARENA_RESPAWN_TICKS 25  // Ticks a dead snake waits before respawning
+#define ARENA_CELL_PIXELS 8  // On-screen size of an arena cell
+#define ARENA_CELL_EMPTY 0
+#define ARENA_CELL_FOOD 0x8000  // Grid values from here up are food slots, below are snake ids + 1
+#define COOP_MAX_PLAYERS 4  // Local players sharing the arena (--coop)
+#define INPUT_SAMPLE_HZ 1000  // Keyboard polling rate of the input thread
+#define INPUT_QUEUE_EVENTS 64  // Turns held per player and source (power of two)
+#define INPUT_MAX_AGE 0.5  // Seconds a queued turn stays valid, so a long pause does not replay old keys
+#define UI_FONT_FILE "snakescape.ttf"  // Optional; text falls back to raylib's built-in font without it
+#define UI_FONT_CACHE "snakescape.font"
+#define UI_FONT_CACHE_TEMP "snakescape.font.tmp"
+#define UI_FONT_VERSION 1
+#define UI_FONT_SIZE 32  // Glyph size in the atlas; distance fields stay sharp well beyond it
+#define UI_FONT_GLYPHS 95  // Printable ASCII
+#define UI_FONT_SPACING 0.05f  // Letter spacing as a fraction of the text size
+#define UI_TEXT_QUEUE 128  // Strings held for one text pass before they must be drawn
+#define UI_TEXT_CHARS 8192
+#define STARTUP_MAX_MARKS 8
+#define STARTUP_TARGET_MS 100.0  // Launch to first front page frame
+#define SAVE_FILE_NAME "snakescape.sav"
+#define SAVE_TEMP_NAME "snakescape.sav.tmp"
+#define MAZE_LEVEL_FILE "maze.lvl"  // Default level, built from the layout in the source when missing
+#define LEVEL_VERSION 1
+#define LEVEL_UNREACHABLE 0xFFFF  // Distance to and from wall cells and sealed-off areas
+#define MAZE_FOOD_MIN_STEPS 12  // Food spawns at least this many steps from the head when it can
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_TOP 10  // Best runs kept in each mode's index
+#define LEADERBOARD_MAX_SCORE BOARD_CELLS  // Scores are clamped here, which keeps the rank table a fixed size
+#define TRACE_BUFFER_EVENTS 8192  // Per thread, power of two; events beyond this are dropped
+#define TRACE_MAX_THREADS 32
+#define REPLAY_VERSION 6  // Bump whenever the simulation changes, since replays re-simulate
+#define REWIND_TICKS 2048  // Moves of history kept, power of two
+#define REWIND_BYTES (1 << 19)  // History ring size, power of two
+#define REWIND_SPEEDUP 2  // History plays back this many times faster than it was played
+#define TOURNAMENT_MAX_POLICIES 16
+#define TOURNAMENT_MAX_WORKERS 64
+#define TOURNAMENT_MAX_SECONDS 300.0f  // Game time before a game that will not end is called
+#define TOURNAMENT_ELO_K 16.0
+#define TOURNAMENT_MODES (MAZE + 1)  // Every single-player mode
+#define SWEEP_MAX_AXES 6
+#define SWEEP_MAX_VALUES 16
+#define SWEEP_MAX_SETTINGS 4096
+#define SWEEP_SECONDS ((int)TOURNAMENT_MAX_SECONDS + 1)  // Survival histogram, one bin per second
+#define SPECTATOR_MAX_GAMES 144
+#define SPECTATOR_GAME_OVER_SECONDS 2.0  // A finished game stays up this long before the next starts
+#define SPECTATOR_STATUS_HEIGHT 24
+#define REPLAY_KEEP 20  // Replay files kept per --record directory; the oldest is overwritten
+#define REPLAY_SLOTS 32  // Frames in flight between the replay renderer and its encoders
+#define REPLAY_MAX_WORKERS 16
+#define SAVE_VERSION 6  // Bump whenever SaveFile or anything it embeds changes layout
+#define NET_DEFAULT_PORT 7777
+#define NET_MAX_PEERS 128  // Remote players a server accepts
+#define NET_HISTORY_TICKS 64  // Ticks of change log kept for delta snapshots
+#define NET_HISTORY_BYTES 65536  // Change log capacity per tick
+#define NET_MAX_PACKET 65000  // Largest datagram we send
+#define NET_SERVER_HEADER 14
+#define NET_CLIENT_PACKET 12
+#define NET_PEER_TIMEOUT 3.0  // Seconds of silence before a peer's snake goes back to the AI
+#define NET_MAX_PREDICTION 4  // Ticks the client may run its own head ahead of the server
+#define NET_INPUT_RING 16  // Steering remembered per tick for re-running predictions (power of two)
+#define VERSUS_MAX_LENGTH 64  // Ring buffer capacity per versus snake (power of two)
+#define VERSUS_TICK_MS 100
+#define VERSUS_INPUT_DELAY 2  // Local inputs take effect this many ticks later, hiding most latency
+#define ROLLBACK_RING 64  // Saved states and inputs (power of two)
+#define ROLLBACK_MAX_TICKS 12  // Deepest re-simulation; prediction stalls beyond this
+#define VERSUS_MAX_QUEUED 256  // Outgoing packets held back by the network simulator
+#define VERSUS_PACKET_INPUTS 32
+#define VERSUS_HEADER 23
 
-void SpawnFood();
+void ResetEntities();
+void ClearParticles();
+void InitArena();
+void StartReplayRecording();
+void ClearRewind();
+void SelectModeKernel();
+int DrawLevelBackground();
+void ApplyCoopInputs(double tickTime);
 
 typedef enum {
     FRONT_PAGE,
@@ -30,26 +161,536 @@ typedef enum {
     CLASSIC,
     TIME_ATTACK,
     CHALLENGE,
-    INFINITE  // New mode
+    INFINITE,  // New mode
+    MAZE,
+    ARENA,
+    VERSUS
 } GameMode;
 
+// Board cell index, row * BOARD_COLS + column; pixels only exist in the render path
+#if BOARD_CELLS <= 65536
+typedef unsigned short Cell;
+#else
+typedef unsigned int Cell;
+#endif
+
+// The body is the tail end of a stream of head positions: each move appends
+// one cell and the newest length cells are the snake. The stream lives in
+// fixed-size chunks from bodyArena, so growth never reallocates or copies.
+typedef struct {
+    Cell* chunks[BODY_CHUNKS];  // Stream chunk n lives at chunks[n % BODY_CHUNKS]
+    unsigned int headSeq;  // Stream position of the head
+    unsigned int tailChunk;  // Oldest chunk still held
+    int length;
+    signed char dx, dy;  // Direction in cells
+    unsigned short bodyAt[BOARD_CELLS];  // Segments on each cell, for O(1) self collision
+} Snake;
+
+typedef enum {
+    PICKUP_FOOD,
+    PICKUP_GOLDEN
+} PickupKind;
+
+// Pickups and phantom walls as parallel arrays, live entries packed at the front
+typedef struct {
+    Cell pickupCell[MAX_PICKUPS];
+    unsigned char pickupKind[MAX_PICKUPS];
+    float pickupLife[MAX_PICKUPS];  // Seconds left for golden fruit, INFINITY until the next food; food stays until eaten
+    int pickupCount;
+    int foodCount;
+    int goldenCount;
+   
+    Cell wallStart[MAX_PHANTOM_WALLS];
+    Cell wallEnd[MAX_PHANTOM_WALLS];
+    float wallTimer[MAX_PHANTOM_WALLS];
+    unsigned char wallCountdown[MAX_PHANTOM_WALLS];
+    unsigned char wallCellCount[MAX_PHANTOM_WALLS];
+    Cell wallCells[MAX_PHANTOM_WALLS][PHANTOM_WALL_MAX_CELLS];
+    int wallCount;
+    float wallSpawnTimer;
+   
+    unsigned char pickupAt[BOARD_CELLS];  // Pickup slot + 1 on each cell, 0 when empty
+    unsigned char wallsAt[BOARD_CELLS];  // Phantom walls covering each cell
+} Entities;
+
+// Start of a maze level file; the file is mapped whole, see LoadLevel
+typedef struct {
+    char magic[4];  // "SNKL"
+    unsigned int version;
+    unsigned int cols, rows;  // Must match the board
+    unsigned int start;  // Head cell; the tail starts one step behind it
+    int startDx, startDy;
+    unsigned int checksum;  // FNV-1a of the start and walls; saves and replays name their level by it
+} LevelHeader;
+
+// One finished run, as appended to its mode's score log
+typedef struct {
+    int score;
+    unsigned int when;  // Unix time the run ended
+    float seconds;  // Game time played
+    unsigned int check;  // FNV-1a of the fields above; a torn append fails it
+} ScoreRecord;
+
+// Everything a rank or top-K query needs, rewritten whole after every run
+typedef struct {
+    char magic[4];  // "SNKB"
+    unsigned int version;
+    unsigned int records;  // Log records folded in; any beyond these are replayed on load
+    unsigned int atOrAbove[LEADERBOARD_MAX_SCORE + 2];  // Runs scoring at least s
+    int topCount;
+    ScoreRecord top[LEADERBOARD_TOP];  // Best first, earlier runs first on ties
+    unsigned int checksum;
+} ScoreIndex;
+
+// Connected free space on the single-player board: every free cell carries a
+// region label, and labels of regions that have joined are merged by union-find
 typedef struct {
-    int x, y;
-} Position;
+    int labelAt[BOARD_CELLS];  // 0 on blocked cells
+    int next[BOARD_CELLS][4];  // Neighbour right, down, left and up, -1 off the board
+    int parent[REACH_LABELS];
+    int size[REACH_LABELS];  // Free cells in the region, valid on root labels
+    int nextLabel;
+    int wrap;  // Infinite mode joins opposite edges
+    int valid;  // Off while the body is rebuilt from scratch; ResetReach turns it back on
+} Reachability;
 
 typedef struct {
-    Position body[SNAKE_MAX_LENGTH];
+    unsigned int body[ARENA_SNAKE_MAX_LENGTH];  // Ring buffer of cell indices, head at body[head]
+    int head;
     int length;
+    int dx, dy;  // Direction in cells
+    int alive;
+    int respawnTimer;  // Ticks left until respawn while dead
+    int movedTick;  // Tick of the last head move, used for head-to-head detection
+    int targetFood;  // Food slot the AI is steering towards
+    int kills;
+    int best;
+    int human;  // Steered by a player instead of the AI
+} ArenaSnake;
+
+typedef struct {
+    unsigned short grid[ARENA_CELLS];  // Shared occupancy: empty, snake id + 1 or ARENA_CELL_FOOD + slot
+    ArenaSnake snakes[ARENA_MAX_SNAKES];
+    int foodCells[ARENA_FOOD_CAPACITY];  // Cell of each food slot, -1 when the slot is free
+    int foodFree[ARENA_FOOD_CAPACITY];  // Stack of free food slots
+    int foodFreeCount;
+    int foodActive;
+    int tick;
+    int aliveCount;
+    unsigned int rng;
+    float tickAccumulator;
+    float tickMs;  // Smoothed cost of one arena tick
+} Arena;
+
+typedef enum {
+    NET_HELLO,
+    NET_INPUT,
+    NET_BYE,
+    NET_FULL,
+    NET_DELTA
+} NetPacketKind;
+
+typedef struct {
+    int active;
+    int socket;
+    unsigned char address[128];  // Server sockaddr storage
+    int addressLength;
+    int tick;  // Last server tick applied to the local arena
+    int kills;
+    double snapshotTime;
+    double statsTime;
+    long bytesReceived;
+    float kilobytesPerSecond;
+   
+    // Client-side prediction of our own snake, re-run from each snapshot, see PredictLocalSnake
+    int predictedFrom;  // Snapshot tick the prediction starts after
+    int predictedCount;
+    unsigned int predictedCells[NET_MAX_PREDICTION];  // Head cell after each predicted move, oldest first
+    unsigned int retractedCells[NET_MAX_PREDICTION];  // Tail cells those moves vacate
+    int retractedCount;
+    int inputTick[NET_INPUT_RING];  // Server tick each steering entry is for
+    signed char inputDx[NET_INPUT_RING], inputDy[NET_INPUT_RING];
+    int corrections;  // Predicted moves a snapshot contradicted
+} NetSession;
+
+// Complete 1v1 simulation state: a few hundred bytes, copied every tick for rollback
+typedef struct {
+    Cell body[2][VERSUS_MAX_LENGTH];  // Ring buffers of cell indices, head at body[p][head[p]]
+    unsigned char head[2];
+    unsigned char length[2];
+    unsigned char direction[2];  // Direction code of the last move
+    unsigned char alive[2];
+    Cell food;
+    unsigned int rng;
+    int tick;
+} VersusState;
+
+typedef struct {
+    unsigned char data[VERSUS_HEADER + VERSUS_PACKET_INPUTS];
+    int size;
+    double sendTime;
+} DelayedPacket;
+
+typedef struct {
+    int active;
+    int started;
+    int player;  // 0 or 1; the peer drives the other snake
+    int socket;
+    unsigned char address[128];  // Peer sockaddr storage
+    int addressLength;
+    unsigned int seed;
+   
+    VersusState states[ROLLBACK_RING];  // states[t % ROLLBACK_RING] is the state before tick t runs
+    unsigned char inputs[ROLLBACK_RING][2];  // Inputs tick t ran with; the remote one may be predicted
+    unsigned char localInputs[ROLLBACK_RING];
+    int localTags[ROLLBACK_RING];  // Tick each local input slot belongs to
+    unsigned char remoteInputs[ROLLBACK_RING];
+    int remoteTags[ROLLBACK_RING];  // Tick each remote input slot belongs to
+    int tick;  // Next tick to simulate
+    int remoteTick;  // Every remote input below this tick has arrived
+    int remoteAck;  // The peer has every local input below this tick
+    unsigned char localDirection;
+    unsigned char lastRemote;
+    double accumulator;
+    double lastSend;
+   
+    // Network simulator for testing on one machine
+    float delayMs;
+    float jitterMs;
+    float lossPercent;
+    DelayedPacket queue[VERSUS_MAX_QUEUED];
+    int queued;
+   
+    int rollbacks;
+    int deepestRollback;
+    int stalls;
+    int desynced;
+} VersusSession;
+
+typedef enum {
+    ARENA_EVENT_HEAD,
+    ARENA_EVENT_TAIL,
+    ARENA_EVENT_DEATH,
+    ARENA_EVENT_FOOD,
+    ARENA_EVENT_BODY
+} ArenaEventType;
+
+// Difficulty knobs; the defaults come from the constants above, --tune and --sweep change them
+typedef struct {
+    int baseSpeed;  // Milliseconds per move at the start of a game
+    int foodSpeedStep[MAZE + 1];  // Milliseconds taken off per food, by mode
+    int goldenSpeedStep;  // Milliseconds taken off per golden fruit
+    float wallInterval;  // Seconds between phantom walls, less any wall ramp
+    float wallDuration;  // Seconds a phantom wall stays up
+    float timeAttackDuration;
+    int foodTarget[MAZE + 1];  // Food kept on the board, by mode
+    int goldenMax;  // Golden fruit on the board at once
+    float goldenLife;  // Seconds a golden fruit lasts; 0 keeps it until the next food appears
+    int wallMax;  // Phantom walls up at once
+    float wallRamp;  // Seconds taken off the wall interval per snake segment
+} Tuning;
+
+// Cached UI font atlas: this header, UI_FONT_GLYPHS glyphs, then the atlas pixels, read back with one mmap
+typedef struct {
+    char magic[4];  // "SNKF"
+    unsigned int version;
+    long long sourceSize;  // Size and modification time of the TTF the atlas was built from
+    long long sourceTime;
+    int baseSize;
+    int glyphCount;
+    int width, height, format;  // Atlas image, in raylib's pixel format
+    unsigned int pixelBytes;
+} FontCacheHeader;
+
+typedef struct {
+    int value;
+    int offsetX, offsetY;
+    int advanceX;
+    Rectangle rec;  // Where the glyph sits in the atlas
+} FontCacheGlyph;
+
+// On-disk snapshot of a single-player game, read back with one mmap
+typedef struct {
+    char magic[4];  // "SNKS"
+    unsigned int version;
+    unsigned int size;  // sizeof(SaveFile), guards against a different compiler layout
+    unsigned int checksum;  // FNV-1a of every byte after this field
+    int mode;
+    int snakeLength;
+    signed char snakeDx, snakeDy;
+    Cell snakeBody[SNAKE_MAX_LENGTH];  // Head first
+    Entities entities;  // Cell lookups are rebuilt on load rather than trusted
+    int speed;
+    float timeAttackTimer;
+    double sinceLastMove;  // Simulation time since the snake last moved
+    unsigned int rng;
+    unsigned int level;  // Checksum of the maze level, 0 in other modes
+    Tuning tuning;  // The game carries on with the knobs it started with
+} SaveFile;
+
+// One finished span or instant, waiting for the trace writer
+typedef struct {
+    const char* name;  // String literal, so only the pointer is copied
+    const char* argName;  // NULL when the event carries no argument
+    double start;  // Microseconds since tracing started
+    double duration;  // Negative for an instant event
+    int arg;
+} TraceEvent;
+
+// Filled by one thread, drained by the trace writer
+typedef struct {
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_int ready;
+    const char* threadName;
+    const char* written;  // Writer only: name last emitted as metadata
+} TraceBuffer;
+
+// A turn by one local player: direction in reachDx/reachDy order, stamped when it was sampled
+typedef struct {
+    double time;
+    int direction;
+} InputEvent;
+
+// Filled by one thread (the input thread or the frame loop), drained by the arena tick
+typedef struct {
+    InputEvent events[INPUT_QUEUE_EVENTS];
+    atomic_uint head;
+    atomic_uint tail;
+} InputQueue;
+
+// One single-player mode's simulation, specialized at compile time
+typedef struct {
+    void (*step)(float deltaTime);  // Per-frame clock and entities
+    int (*moveSnake)();  // One move; returns the pickup kind eaten, or -1
+    int endsOnDeath;
+} ModeKernel;
+
+// What one snake move changed, recorded just before it; pickups and walls follow it in the ring
+typedef struct {
+    Cell head;  // Cell the move pushed
+    Cell tail;  // Tail before the move, put back when the move did not grow the snake
+    unsigned char growth;  // Segments gained
+    signed char dx, dy;
+    unsigned char pickupCount;
+    unsigned char wallCount;
+    int speed;
+    float timeAttackTimer;
+    float wallSpawnTimer;
+    unsigned int rng;
+} RewindTick;
+
+#define REWIND_MAX_RECORD (sizeof(RewindTick) + MAX_PICKUPS * (sizeof(Cell) + 1 + sizeof(float)) + \
+                           MAX_PHANTOM_WALLS * (2 * sizeof(Cell) + sizeof(float) + 2 + PHANTOM_WALL_MAX_CELLS * sizeof(Cell)))
+
+// What a bot policy sees before each move; plugin policies are built against this layout
+typedef struct {
+    int cols, rows;
+    int mode;
+    int wrap;  // Edges wrap around instead of killing
+    int head;  // Cell index, row * cols + column
     int dx, dy;
-} Snake;
+    int length;
+    const unsigned short* bodyAt;  // Snake segments on each cell
+    const unsigned char* wallsAt;  // Phantom and maze walls on each cell
+    const int* pickupCells;
+    int pickupCount;
+    unsigned int* rng;  // Seeded per game, for policies that want randomness
+    const unsigned short* distances;  // Maze mode: steps from cell a to cell b at [a * cols * rows + b], else NULL
+} BotView;
+
+// Returns the direction to take: 0 right, 1 down, 2 left, 3 up
+typedef int (*BotPolicyFn)(const BotView* view);
+
+typedef struct {
+    const char* name;
+    BotPolicyFn choose;
+} BotPolicy;
+
+typedef enum {
+    BOT_HIT_EDGE,
+    BOT_HIT_SELF,
+    BOT_HIT_WALL,
+    BOT_TIME_UP,
+    BOT_SURVIVED,
+    BOT_CAUSE_COUNT
+} BotGameEnd;
+
+typedef struct {
+    int score;
+    float seconds;  // Game time survived
+    int cause;
+} BotGameResult;
+
+// A bot-driven game in progress; the simulation itself lives in the playing thread's state
+typedef struct {
+    BotPolicyFn policy;
+    BotView view;
+    int pickupCells[MAX_PICKUPS];
+    unsigned int policyRng;
+    BotGameResult result;
+} BotGame;
+
+typedef struct {
+    BotPolicy policies[TOURNAMENT_MAX_POLICIES];
+    int policyCount;
+    int seeds;  // Games per policy and mode
+    BotGameResult* results;  // By mode, then seed, then policy
+} Tournament;
+
+// Outcomes of every game played with one sweep setting; workers add to it as games finish
+typedef struct {
+    atomic_int scores[LEADERBOARD_MAX_SCORE + 1];
+    atomic_int seconds[SWEEP_SECONDS];  // Game time survived, in whole seconds
+    atomic_int causes[BOT_CAUSE_COUNT];
+} SweepTally;
+
+typedef struct {
+    int axisCount;
+    char axisNames[SWEEP_MAX_AXES][32];
+    float axisValues[SWEEP_MAX_AXES][SWEEP_MAX_VALUES];
+    int valueCounts[SWEEP_MAX_AXES];
+    int settingCount;  // Every combination of axis values, the last axis varying fastest
+    Tuning* settings;
+    SweepTally* tallies;
+    int games;  // Per setting, on the same seeds for every setting
+    int mode;
+    BotPolicyFn policy;
+} Sweep;
+
+// What the main thread needs to draw one spectated game, republished by its worker after every move
+typedef struct {
+    int mode;
+    int length;
+    int dx, dy;
+    float timeAttackTimer;
+    int over;
+    Entities entities;
+    Cell body[SNAKE_MAX_LENGTH];
+} SpectatorFrame;
+
+typedef struct {
+    int policy;
+    int mode;
+    unsigned int seed;  // Of the game being played; each next game adds the number of games
+    atomic_int generation;  // Bumped after every publish
+    int drawnGeneration;  // Main thread only, like everything below
+    int score;
+    RenderTexture2D tile;
+    SpectatorFrame frame;  // Guarded by the game's lock
+} SpectatorGame;
+
+// A replay is the state the game started from plus every frame's inputs
+typedef struct {
+    char magic[4];  // "SNKR"
+    unsigned int version;
+    SaveFile start;
+} ReplayHeader;
+
+typedef struct {
+    float deltaTime;
+    signed char dx;
+    signed char dy;
+    unsigned char paused;
+    unsigned char rewinding;
+} ReplayFrame;
+
+// One frame on its way from the replay renderer to an encoder thread
+typedef struct {
+    Image image;
+    unsigned char* planes;  // Y4M output only
+    atomic_int frame;
+    atomic_int state;  // REPLAY_SLOT_FREE / FILLED / ENCODED
+} ReplaySlot;
+
+enum { REPLAY_SLOT_FREE, REPLAY_SLOT_FILLED, REPLAY_SLOT_ENCODED };
+
+// What one board cell shows, compared by the dirty-region renderer
+typedef struct {
+    unsigned char kind;  // 0 empty, 1 body, 2 head, 3 food, 4 golden fruit
+    unsigned char wall;
+    signed char dx, dy;  // Head direction, for the eyes
+    Color color;
+} CellLook;
+
+typedef enum {
+    SFX_EAT,
+    SFX_GOLDEN,
+    SFX_BEEP,
+    SFX_BEEP_HIGH,
+    SFX_DEATH,
+    SFX_MUSIC,
+    SFX_COUNT
+} SoundId;
+
+typedef enum {
+    AUDIO_PLAY,
+    AUDIO_STOP_TAG  // Silences every voice carrying the tag, started or still scheduled
+} AudioCommandType;
+
+typedef enum {
+    AUDIO_TAG_NONE,
+    AUDIO_TAG_WALL,
+    AUDIO_TAG_MUSIC  // Music voices loop
+} AudioTag;
+
+typedef struct {
+    short* samples;
+    int length;
+} PcmBuffer;
+
+typedef struct {
+    unsigned char type;
+    unsigned char sound;
+    unsigned char tag;
+    float volume;
+    unsigned long long startFrame;  // Mixer frame to start on; anything already past plays at once
+} AudioCommand;
 
 typedef struct {
-    Position start;
-    Position end;
-    float timer;
     int active;
-    int countdown; 
-} PhantomWall;
+    int sound;
+    int tag;
+    float volume;
+    unsigned long long startFrame;
+} AudioVoice;
+
+typedef enum {
+    CAPTURE_NONE,
+    CAPTURE_SCREENSHOT,
+    CAPTURE_PNG_SEQUENCE,
+    CAPTURE_Y4M
+} CaptureKind;
+
+// What a capture target's contents are destined for
+typedef struct {
+    int kind;
+    int recording;  // Recording number, or screenshot number
+    int sequence;  // Frame number inside the recording
+    int repeat;  // Output frames this one stands for, see EndFrame
+} CaptureHeld;
+
+typedef struct {
+    Image image;  // RGBA, bottom-up as read from the render texture; the buffer is reused
+    int kind;
+    int recording;
+    int sequence;
+    int repeat;
+} CaptureFrame;
+
+// Effect particles as parallel arrays, live ones packed at the front
+typedef struct {
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float vx[MAX_PARTICLES];
+    float vy[MAX_PARTICLES];
+    float life[MAX_PARTICLES];  // Seconds left
+    float fade[MAX_PARTICLES];  // 1 / starting life, scales alpha down to zero
+    float size[MAX_PARTICLES];
+    Color color[MAX_PARTICLES];
+    int count;
+} Particles;
 
 typedef struct {
     Rectangle rect;
@@ -60,15 +701,26 @@ typedef struct {
     bool hover;
 } Button;
 
-Position food, goldenFruit;
-Snake snake;
-PhantomWall phantomWall;
-int running = 1;
-int goldenActive = 0;
-int paused = 0;
-int speed = BASE_SPEED;
+// Single-player simulation state is per thread, so headless tools can run a game on every core
+_Thread_local Snake snake;
+_Thread_local Cell bodyArena[BODY_CHUNKS][BODY_CHUNK_CELLS];
+_Thread_local Cell* bodyFree[BODY_CHUNKS];  // Unused arena chunks
+_Thread_local int bodyFreeCount = 0;
+_Thread_local Entities entities;
+_Thread_local int spawnedWall = -1;  // Phantom wall placed by the last entity step, or -1
+_Thread_local Reachability reach;
+_Thread_local int running = 1;
+_Thread_local int paused = 0;
+_Thread_local int speed = BASE_SPEED;
+_Thread_local Tuning tuning = DEFAULT_TUNING;  // Knobs of the game being simulated
+_Thread_local Cell boardChanges[BOARD_CHANGES_MAX];  // Cells whose contents changed since the board shader last looked
+_Thread_local int boardChangeCount = BOARD_CHANGES_MAX + 1;  // Past BOARD_CHANGES_MAX: everything changed
+Tuning playTuning = DEFAULT_TUNING;  // Knobs for games started in this process (--tune)
+const char* tuningNames[] = { "speed", "step", "golden-step", "wall-interval", "wall-duration", "time",
+                              "food", "golden", "golden-life", "walls", "wall-ramp" };
 double lastUpdateTime = 0;
-float phantomWallTimer = 0;
+double gameClock = 0;  // Simulation time fed from frame deltas, never read from the wall clock
+_Thread_local unsigned int gameRng = 1;  // Simulation RNG state, seeded once per game
 float countdownTimer = COUNTDOWN_DURATION;
 
 Color bgColor = { 0, 0, 0, 255 };              // Pure black background
@@ -78,20 +730,433 @@ Color accentColor1 = { 193, 255, 114, 255 };   // Bright lime green (#c1ff72) -
 Color accentColor2 = { 92, 225, 230, 255 };    // Bright cyan (#5ce1e6) - secondary accent
 Color accentColor3 = { 255, 215, 0, 255 };     // Gold for highlights
 Color phantomWallColor = {255, 100, 100, 255}; // Red for danger (phantom walls)
+Color levelWallColor = { 70, 90, 140, 255 };    // Slate blue for maze walls
 
 // Menu buttons
-Button menuButtons[4];
+Button menuButtons[6];
 Button startButton;
 Button exitButton;
 
 // Game state variables
 GameState currentState = FRONT_PAGE;
-GameMode currentMode = CLASSIC;
+_Thread_local GameMode currentMode = CLASSIC;
 GameMode selectedMode = CLASSIC;
-float timeAttackTimer = TIME_ATTACK_DURATION;
+_Thread_local float timeAttackTimer = TIME_ATTACK_DURATION;
 int selectedOption = 0;
-const int numOptions = 4;
-char* menuOptions[] = {"Classic Mode", "Time Attack Mode", "Challenge Mode", "Infinite Play"};
+const int numOptions = 6;
+char* menuOptions[] = {"Classic Mode", "Time Attack Mode", "Challenge Mode", "Infinite Play", "Maze Mode", "Snake Arena"};
+const char* gameStateNames[] = {"FRONT_PAGE", "MENU", "COUNTDOWN", "GAME", "GAME_OVER"};
+_Thread_local const ModeKernel* modeKernel;  // Chosen by ResetGame, see SelectModeKernel
+
+// Arena mode state (large, so kept out of the stack)
+Arena arena;
+Color arenaColors[ARENA_MAX_SNAKES];
+int arenaPlayer = 0;  // Snake driven by this process, -1 on a headless server
+
+// Local co-op: snakes 0 to coopPlayers - 1 belong to players on this machine
+int coopPlayers = 0;
+InputQueue inputQueues[COOP_MAX_PLAYERS][2];  // Keyboard, gamepad
+int inputThreaded = 0;  // Keyboard is polled by the input thread rather than the frame loop
+atomic_int inputThreadRunning = 0;
+atomic_int inputFocused = 0;  // Keys only count while the game window has focus
+atomic_int inputSamples = 0;  // Keyboard polls since the rate was last measured
+float inputRate = 0;
+double inputRateStart = 0;
+const int coopKeys[COOP_MAX_PLAYERS][4] = {  // Right, down, left, up
+    { KEY_D, KEY_S, KEY_A, KEY_W },
+    { KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP },
+    { KEY_L, KEY_K, KEY_J, KEY_I },
+    { KEY_KP_6, KEY_KP_5, KEY_KP_4, KEY_KP_8 }
+};
+#ifndef _WIN32
+const unsigned long coopKeysyms[COOP_MAX_PLAYERS][4] = {  // The same keys as X keysyms
+    { 0x64, 0x73, 0x61, 0x77 },
+    { 0xff53, 0xff54, 0xff51, 0xff52 },
+    { 0x6c, 0x6b, 0x6a, 0x69 },
+    { 0xffb6, 0xffb5, 0xffb4, 0xffb8 }
+};
+unsigned char inputKeycodes[COOP_MAX_PLAYERS][4];
+pthread_t inputThread;
+void* inputLibrary = NULL;  // libX11, opened at run time so the game does not link against it
+void* inputDisplay = NULL;  // The input thread's own X connection
+int (*inputQueryKeymap)(void*, char*) = NULL;
+int (*inputCloseDisplay)(void*) = NULL;
+#endif
+
+// Per-tick arena change log, only captured while a server points it at a buffer
+unsigned char* arenaEventLog = NULL;
+int arenaEventBytes = 0;
+int arenaEventCapacity = 0;
+int arenaEventOverflow = 0;
+
+// Visual effects; particleRng stays apart from gameRng so effects never change a replay
+Particles particles;
+unsigned int particleRng = 1;
+
+// GPU board for single-player modes
+Shader boardShader;
+Texture2D boardTexture;
+int boardShaderReady = 0;
+int boardHeadStampLoc, boardLengthLoc, boardColorLoc, boardDirLoc, boardEmptyAlphaLoc;
+unsigned char boardTexels[BOARD_CELLS][4];  // Cell states as last uploaded
+Cell boardLastHead = 0;
+unsigned int boardLastSeq = 0;  // Head stream position at the last upload
+
+// Dirty-region rendering (--dirty-redraw) for software GL
+int dirtyRedraw = 0;
+RenderTexture2D boardCanvas;
+int canvasValid = 0;  // Cleared whenever the canvas must be repainted from scratch
+CellLook canvasCells[BOARD_CELLS];  // What each canvas cell shows right now
+char canvasHud[64];  // HUD state the canvas nav bar was drawn for
+int dirtyPixels = 0;  // Canvas pixels repainted this frame
+
+// Audio: the queue indices and clock are the only state both threads touch
+AudioStream audioStream;
+int audioReady = 0;
+int audioLive = 0;  // Music is running
+int audioWallsLive = 0;  // Wall beeps are queued from the current wall timers
+PcmBuffer audioSounds[SFX_COUNT];
+AudioCommand audioQueue[AUDIO_QUEUE_SIZE];
+atomic_uint audioQueueHead = 0;  // Next slot the game thread fills
+atomic_uint audioQueueTail = 0;  // Next slot the audio thread reads
+atomic_ullong audioClock = 0;  // Frames mixed so far
+AudioVoice audioVoices[AUDIO_MAX_VOICES];  // Audio thread only
+float audioMix[AUDIO_MIX_CHUNK];  // Audio thread only
+
+// Capture pipeline (F9 records, F12 takes a screenshot)
+int captureFormat = CAPTURE_Y4M;  // --capture-format png|y4m
+int captureRecording = 0;
+int captureScreenshot = 0;
+int captureRecordingId = 0;
+int captureSequence = 0;
+int captureShots = 0;
+int captureDropped = 0;
+double captureRecordStart = 0;
+int captureRecordFrames = 0;  // Displayed frames while recording, for the report when it stops
+double captureRecordMs = 0;  // Their summed frame time
+double captureReadbackMs = 0;  // Their summed readback cost on the game thread
+float captureIdleMs = 0;  // Smoothed frame time while not recording
+long captureSession = 0;  // Start time, keeps file names of separate runs apart
+RenderTexture2D captureTargets[2];
+CaptureHeld captureHeld[2];
+int captureIndex = 0;  // Target the current frame draws into
+int captureFrameOpen = 0;
+CaptureFrame captureQueue[CAPTURE_QUEUE_FRAMES];
+atomic_uint captureQueueHead = 0;
+atomic_uint captureQueueTail = 0;
+atomic_int captureWritten = 0;
+atomic_int captureThreadRunning = 0;
+int captureThreadStarted = 0;
+#ifndef _WIN32
+pthread_t captureThread;
+int captureBufferState = 0;  // Pixel-pack buffers: 0 not tried yet, 1 in use, -1 unavailable
+unsigned int captureBuffers[2];  // One per capture target
+int captureBufferPending[2];  // A readback into the buffer has been issued and not collected
+void (*captureGenBuffers)(int, unsigned int*) = NULL;  // GL entry points, looked up at run time
+void (*captureDeleteBuffers)(int, const unsigned int*) = NULL;
+void (*captureBindBuffer)(unsigned int, unsigned int) = NULL;
+void (*captureBufferData)(unsigned int, ptrdiff_t, const void*, unsigned int) = NULL;
+void (*captureReadPixels)(int, int, int, int, unsigned int, unsigned int, void*) = NULL;
+void* (*captureMapBufferRange)(unsigned int, ptrdiff_t, ptrdiff_t, unsigned int) = NULL;
+unsigned char (*captureUnmapBuffer)(unsigned int) = NULL;
+#endif
+
+// Event tracing
+int tracing = 0;
+FILE* traceFile = NULL;  // Writer thread only once tracing has started
+TraceBuffer traceBuffers[TRACE_MAX_THREADS];
+atomic_int traceBufferCount = 0;
+_Thread_local TraceBuffer* traceLocal = NULL;
+atomic_int traceDropped = 0;
+atomic_int traceWriterRunning = 0;
+int traceEvents = 0;  // Writer thread only
+double traceOrigin = 0;
+#ifndef _WIN32
+pthread_t traceWriter;
+#endif
+
+// Rewind history, newest record last
+unsigned char rewindBytes[REWIND_BYTES];
+unsigned int rewindStart[REWIND_TICKS];  // Ring position of each record, by move number
+unsigned int rewindFirst = 0;  // Live records are moves [rewindFirst, rewindLast)
+unsigned int rewindLast = 0;
+unsigned int rewindEnd = 0;  // Ring position after the newest record
+int rewindMilliseconds = 0;  // Play time the history covers
+float rewindBudget = 0;  // Milliseconds owed to the rewind in progress
+int rewinding = 0;
+
+Tournament tournament;
+Sweep sweep;
+
+// Maze level, mapped read-only and shared by every thread
+const char* levelPath = MAZE_LEVEL_FILE;  // --level
+const LevelHeader* level = NULL;
+const unsigned char* levelWalls = NULL;
+const unsigned short* levelDistances = NULL;  // BOARD_CELLS rows of BOARD_CELLS
+char levelLoaded[512];  // Path the mapping came from
+RenderTexture2D levelBackground;  // Grid and walls, drawn once per level
+unsigned int levelBackgroundChecksum = 0;  // Level the background was drawn for, 0 for none
+
+// Spectator wall (--spectate): one bot game per tile, each played on its own thread
+SpectatorGame* spectatorGames = NULL;
+int spectatorCount = 0;
+atomic_int spectatorStop = 0;
+#ifndef _WIN32
+pthread_t spectatorThreads[SPECTATOR_MAX_GAMES];
+pthread_mutex_t spectatorLocks[SPECTATOR_MAX_GAMES];
+#endif
+
+// Leaderboard indexes, loaded per mode on first use
+ScoreIndex leaderboards[MAZE + 1];
+int leaderboardLoaded[MAZE + 1];
+int lastRank = 0;  // Rank of the run that just ended, 0 when it was not recorded
+
+// UI font (--font), drawn from a distance field atlas when one could be loaded
+const char* uiFontPath = UI_FONT_FILE;
+Font uiFont;
+Shader uiFontShader;
+int uiFontReady = 0;
+int uiFontBuilt = 0;  // The atlas was rebuilt this launch: a cold start
+
+// Text waiting for the next FlushUiText, drawn under one shader pass
+typedef struct {
+    int offset;  // Into uiTextChars
+    int x, y, fontSize;
+    Color color;
+} UiTextRun;
+UiTextRun uiTextRuns[UI_TEXT_QUEUE];
+char uiTextChars[UI_TEXT_CHARS];
+int uiTextCount = 0;
+int uiTextUsed = 0;
+
+// Startup: milestones until the first frame, and resources created on first use
+double startupStart = 0;
+const char* startupNames[STARTUP_MAX_MARKS];
+double startupTimes[STARTUP_MAX_MARKS];  // Milliseconds since main() started
+int startupMarks = 0;
+int startupReported = 0;
+int gameResourcesReady = 0;  // Board shader, audio and the dirty-redraw canvas
+
+// Replays: with --record, every single-player game records its inputs so it can be rendered offline later
+const char* replayDir = NULL;  // --record; recording is off without it
+FILE* replayFile = NULL;
+int replayPlayback = 0;  // Re-simulating a replay; the simulation must not touch the save
+RenderTexture2D offlineTarget;  // Frames go here instead of the window while rendering a replay
+double offlineClock = 0;
+ReplaySlot replaySlots[REPLAY_SLOTS];
+atomic_int replayNextJob = 0;
+atomic_int replayQueued = 0;
+atomic_int replayFinished = 0;
+int replayPng = 0;
+const char* replayOutput = NULL;
+
+// Client side of a networked arena
+NetSession netSession;
+
+// Rollback 1v1 session
+VersusSession versus;
+
+// xorshift32: tiny, fast and identical on every platform, so seeded games replay exactly
+unsigned int SimRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int SimRandomRange(unsigned int* state, int min, int max) {
+    return min + (int)(SimRandom(state) % (unsigned int)(max - min + 1));
+}
+
+unsigned int SeedRandom(unsigned int seed) {
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed ^= seed >> 4;
+    seed *= 0x27d4eb2d;
+    seed ^= seed >> 15;
+    return seed ? seed : 0x9E3779B9;
+}
+
+// Seconds on a clock that never jumps; usable before the window exists, unlike GetTime()
+#ifndef _WIN32
+
+double MonotonicSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+#else
+
+double MonotonicSeconds() {
+    return (double)clock() / CLOCKS_PER_SEC;  // Wall time since the process started on Windows
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Event tracing (--trace file.json). Each thread appends spans to its own
+// ring without locks; a writer thread drains the rings into Chrome
+// trace-event JSON, which chrome://tracing and Perfetto open directly. When
+// tracing is off every probe is a single branch.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+double TraceNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3 - traceOrigin;
+}
+
+#else
+
+double TraceNow() {
+    return 0;
+}
+
+#endif
+
+// Names the calling thread in the trace and gives it a buffer
+void TraceThreadName(const char* name) {
+    if (!tracing) return;
+    if (traceLocal == NULL) {
+        int index = atomic_fetch_add(&traceBufferCount, 1);
+        if (index >= TRACE_MAX_THREADS) return;
+        traceLocal = &traceBuffers[index];
+    }
+    traceLocal->threadName = name;
+    atomic_store_explicit(&traceLocal->ready, 1, memory_order_release);
+}
+
+void TracePush(const char* name, double start, double duration, const char* argName, int arg) {
+    if (traceLocal == NULL) {
+        TraceThreadName("worker");
+        if (traceLocal == NULL) return;
+    }
+    unsigned int head = atomic_load_explicit(&traceLocal->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&traceLocal->tail, memory_order_acquire);
+    if (head - tail >= TRACE_BUFFER_EVENTS) {
+        atomic_fetch_add_explicit(&traceDropped, 1, memory_order_relaxed);  // Writer is behind
+        return;
+    }
+   
+    TraceEvent* event = &traceLocal->events[head & (TRACE_BUFFER_EVENTS - 1)];
+    event->name = name;
+    event->argName = argName;
+    event->start = start;
+    event->duration = duration;
+    event->arg = arg;
+    atomic_store_explicit(&traceLocal->head, head + 1, memory_order_release);
+}
+
+double TraceBegin() {
+    return tracing ? TraceNow() : 0;
+}
+
+// Records a span from a TraceBegin() timestamp to now; argName may be NULL
+void TraceSpan(const char* name, double start, const char* argName, int arg) {
+    if (!tracing) return;
+    TracePush(name, start, TraceNow() - start, argName, arg);
+}
+
+void TraceInstant(const char* name, const char* argName, int arg) {
+    if (!tracing) return;
+    TracePush(name, TraceNow(), -1, argName, arg);
+}
+
+#ifndef _WIN32
+
+void WriteTraceEvents() {
+    int count = atomic_load_explicit(&traceBufferCount, memory_order_acquire);
+    if (count > TRACE_MAX_THREADS) count = TRACE_MAX_THREADS;
+   
+    for (int b = 0; b < count; b++) {
+        TraceBuffer* buffer = &traceBuffers[b];
+        if (!atomic_load_explicit(&buffer->ready, memory_order_acquire)) continue;
+        if (buffer->written != buffer->threadName) {
+            fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    traceEvents++ ? ",\n" : "", b + 1, buffer->threadName);
+            buffer->written = buffer->threadName;
+        }
+       
+        unsigned int tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            TraceEvent* event = &buffer->events[tail & (TRACE_BUFFER_EVENTS - 1)];
+            fprintf(traceFile, "%s{\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,",
+                    traceEvents++ ? ",\n" : "", event->name, b + 1, event->start);
+            if (event->duration >= 0) {
+                fprintf(traceFile, "\"ph\":\"X\",\"dur\":%.3f", event->duration);
+            } else {
+                fputs("\"ph\":\"i\",\"s\":\"g\"", traceFile);
+            }
+            if (event->argName != NULL) {
+                fprintf(traceFile, ",\"args\":{\"%s\":%d}", event->argName, event->arg);
+            }
+            fputc('}', traceFile);
+        }
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+    }
+}
+
+void* TraceWriterMain(void* unused) {
+    (void)unused;
+    while (atomic_load_explicit(&traceWriterRunning, memory_order_acquire)) {
+        WriteTraceEvents();
+        usleep(10000);
+    }
+    WriteTraceEvents();
+    return NULL;
+}
+
+void StopTracing() {
+    if (!tracing) return;
+    tracing = 0;
+    atomic_store_explicit(&traceWriterRunning, 0, memory_order_release);
+    pthread_join(traceWriter, NULL);
+    fputs("\n]\n", traceFile);
+    fclose(traceFile);
+    traceFile = NULL;
+    if (atomic_load(&traceDropped) > 0) {
+        fprintf(stderr, "Trace dropped %d events\n", atomic_load(&traceDropped));
+    }
+}
+
+int StartTracing(const char* path) {
+    traceFile = fopen(path, "w");
+    if (traceFile == NULL) {
+        fprintf(stderr, "Could not create trace file %s\n", path);
+        return 0;
+    }
+    fputs("[\n", traceFile);
+    traceOrigin = 0;
+    traceOrigin = TraceNow();
+    tracing = 1;
+    atomic_store(&traceWriterRunning, 1);
+    if (pthread_create(&traceWriter, NULL, TraceWriterMain, NULL) != 0) {
+        tracing = 0;
+        fclose(traceFile);
+        return 0;
+    }
+    TraceThreadName("main");
+    atexit(StopTracing);  // Headless entry points return straight out of main
+    return 1;
+}
+
+#else
+
+int StartTracing(const char* path) {
+    fprintf(stderr, "Tracing needs POSIX threads and is not available on this platform\n");
+    return 0;
+}
+
+void StopTracing() {
+}
+
+#endif
 
 void InitButtons() {
     // Initialize start button for front page
@@ -121,19 +1186,21 @@ void InitButtons() {
     exitButton.hover = false;
    
     // Initialize menu buttons with bright theme
-    Color buttonColors[4] = {
+    Color buttonColors[6] = {
         (Color){193, 255, 114, 255},  // Classic - lime green
         (Color){92, 225, 230, 255},   // Time Attack - cyan
         (Color){150, 240, 180, 255},  // Challenge - mint green
-        (Color){255, 220, 100, 255}   // Infinite Play - bright yellow
+        (Color){255, 220, 100, 255},  // Infinite Play - bright yellow
+        (Color){255, 170, 120, 255},  // Maze - apricot
+        (Color){215, 160, 235, 255}   // Snake Arena - lilac
     };
    
     for (int i = 0; i < numOptions; i++) {
         menuButtons[i].rect = (Rectangle){
             SCREEN_WIDTH/2 - 150,
-            250 + i * 70,
+            175 + i * 56,
             300,
-            50
+            46
         };
         menuButtons[i].baseColor = buttonColors[i];
         menuButtons[i].hoverColor = (Color){
@@ -148,420 +1215,4739 @@ void InitButtons() {
     }
 }
 
-void InitSnake() {
-    snake.length = 2;
-    for (int i = 0; i < snake.length; i++) {
-        snake.body[i].x = (SCREEN_WIDTH / GRID_SIZE / 2) * GRID_SIZE - i * GRID_SIZE;
-        snake.body[i].y = ((SCREEN_HEIGHT - NAV_BAR_HEIGHT) / GRID_SIZE / 2 + NAV_BAR_HEIGHT / GRID_SIZE) * GRID_SIZE;
-    }
-    snake.dx = GRID_SIZE;
-    snake.dy = 0;
+int CellX(Cell cell) {
+    return (cell % BOARD_COLS) * GRID_SIZE;
 }
 
-void ResetGame() {
-    running = 1;
-    paused = 0;
-    speed = BASE_SPEED;
-    timeAttackTimer = TIME_ATTACK_DURATION;
-    phantomWallTimer = 0;
-    phantomWall.active = 0;
-    phantomWall.countdown = 0;
-    goldenActive = 0;
-    currentMode = selectedMode;
-    InitSnake();
-    SpawnFood();
+int CellY(Cell cell) {
+    return NAV_BAR_HEIGHT + (cell / BOARD_COLS) * GRID_SIZE;
 }
 
-void SpawnFood() {
-    do {
-        food.x = (GetRandomValue(0, (SCREEN_WIDTH / GRID_SIZE) - 1)) * GRID_SIZE;
-        food.y = (GetRandomValue(0, (SCREEN_HEIGHT / GRID_SIZE) - 1)) * GRID_SIZE;
-    } while (food.y < NAV_BAR_HEIGHT);
+// ---------------------------------------------------------------------------
+// Reachability. Pickups only spawn where the head can get to, so food never
+// lands in a pocket the body has sealed off. The body and walls report every
+// cell that becomes blocked or free. Freeing a cell joins regions with
+// union-find straight away. Blocking one searches only when its 3x3
+// neighbourhood shows it may cut a region in two, and then from every side in
+// lockstep, stopping once they meet or one runs out, so a split costs the
+// smaller side instead of a flood fill of the board.
+// ---------------------------------------------------------------------------
 
-    if (currentMode == CHALLENGE) {
-        if (GetRandomValue(0, 4) == 0) {
-            do {
-                goldenFruit.x = (GetRandomValue(0, (SCREEN_WIDTH / GRID_SIZE) - 1)) * GRID_SIZE;
-                goldenFruit.y = (GetRandomValue(0, (SCREEN_HEIGHT / GRID_SIZE) - 1)) * GRID_SIZE;
-            } while (goldenFruit.y < NAV_BAR_HEIGHT);
-            goldenActive = 1;
-        } else {
-            goldenActive = 0;
-        }
-    } else {
-        goldenActive = 0;
+const int reachDx[4] = { 1, 0, -1, 0 };
+const int reachDy[4] = { 0, 1, 0, -1 };
+
+int CellBlocked(Cell cell) {
+    return snake.bodyAt[cell] > 0 || entities.wallsAt[cell] > 0;
+}
+
+// Cell at an offset from cell, or -1 off the board
+int ReachOffset(Cell cell, int ox, int oy) {
+    int x = cell % BOARD_COLS + ox;
+    int y = cell / BOARD_COLS + oy;
+    if (reach.wrap) {
+        x = (x + BOARD_COLS) % BOARD_COLS;
+        y = (y + BOARD_ROWS) % BOARD_ROWS;
+    } else if (x < 0 || x >= BOARD_COLS || y < 0 || y >= BOARD_ROWS) {
+        return -1;
     }
+    return y * BOARD_COLS + x;
 }
 
-void GeneratePhantomWall() {
-    if (currentMode != CHALLENGE) return;
-   
-    int dx = food.x - snake.body[0].x;
-    int dy = food.y - snake.body[0].y;
-   
-    float distance = sqrtf(dx*dx + dy*dy);
-    if (distance < GRID_SIZE) {
-        phantomWall.active = 0;
-        return;
+int FindRegion(int label) {
+    while (reach.parent[label] != label) {
+        reach.parent[label] = reach.parent[reach.parent[label]];
+        label = reach.parent[label];
     }
-   
-    float ndx = dx / distance;
-    float ndy = dy / distance;
-   
-    float midPointX = snake.body[0].x + (dx * 0.33f);
-    float midPointY = snake.body[0].y + (dy * 0.33f);
-   
-    midPointX = roundf(midPointX / GRID_SIZE) * GRID_SIZE;
-    midPointY = roundf(midPointY / GRID_SIZE) * GRID_SIZE;
-   
-    float perpX = -ndy;
-    float perpY = ndx;
-   
-    int wallLength = 4 + snake.length / 3;
-    if (wallLength > 12) wallLength = 12;
-   
-    phantomWall.start.x = midPointX + perpX * wallLength * GRID_SIZE / 2;
-    phantomWall.start.y = midPointY + perpY * wallLength * GRID_SIZE / 2;
-    phantomWall.end.x = midPointX - perpX * wallLength * GRID_SIZE / 2;
-    phantomWall.end.y = midPointY - perpY * wallLength * GRID_SIZE / 2;
-   
-    if (phantomWall.start.x < 0) phantomWall.start.x = 0;
-    if (phantomWall.start.x >= SCREEN_WIDTH) phantomWall.start.x = SCREEN_WIDTH - GRID_SIZE;
-    if (phantomWall.start.y < NAV_BAR_HEIGHT) phantomWall.start.y = NAV_BAR_HEIGHT;
-    if (phantomWall.start.y >= SCREEN_HEIGHT) phantomWall.start.y = SCREEN_HEIGHT - GRID_SIZE;
-   
-    if (phantomWall.end.x < 0) phantomWall.end.x = 0;
-    if (phantomWall.end.x >= SCREEN_WIDTH) phantomWall.end.x = SCREEN_WIDTH - GRID_SIZE;
-    if (phantomWall.end.y < NAV_BAR_HEIGHT) phantomWall.end.y = NAV_BAR_HEIGHT;
-    if (phantomWall.end.y >= SCREEN_HEIGHT) phantomWall.end.y = SCREEN_HEIGHT - GRID_SIZE;
-   
-    phantomWall.active = 1;
-    phantomWall.timer = PHANTOM_WALL_DURATION;
-    phantomWall.countdown = 3;  
+    return label;
 }
 
-int IsPointOnPhantomWall(int x, int y) {
-    if (!phantomWall.active) return 0;
-   
-    int minX = phantomWall.start.x < phantomWall.end.x ? phantomWall.start.x : phantomWall.end.x;
-    int maxX = phantomWall.start.x > phantomWall.end.x ? phantomWall.start.x : phantomWall.end.x;
-    int minY = phantomWall.start.y < phantomWall.end.y ? phantomWall.start.y : phantomWall.end.y;
-    int maxY = phantomWall.start.y > phantomWall.end.y ? phantomWall.start.y : phantomWall.end.y;
-   
-    if (maxX - minX < maxY - minY) {
-        if (x >= minX && x <= maxX + GRID_SIZE && y >= minY && y <= maxY) {
-            float t = (float)(x - phantomWall.start.x) / (phantomWall.end.x - phantomWall.start.x);
-            if (isnan(t)) t = 0;
-            float interpolatedY = phantomWall.start.y + t * (phantomWall.end.y - phantomWall.start.y);
-            return (y >= interpolatedY - GRID_SIZE && y <= interpolatedY + GRID_SIZE);
-        }
-    } else {
-        if (y >= minY && y <= maxY + GRID_SIZE && x >= minX && x <= maxX) {
-            float t = (float)(y - phantomWall.start.y) / (phantomWall.end.y - phantomWall.start.y);
-            if (isnan(t)) t = 0;
-            float interpolatedX = phantomWall.start.x + t * (phantomWall.end.x - phantomWall.start.x);
-            return (x >= interpolatedX - GRID_SIZE && x <= interpolatedX + GRID_SIZE);
-        }
+void JoinRegions(int a, int b) {
+    a = FindRegion(a);
+    b = FindRegion(b);
+    if (a == b) return;
+    if (reach.size[a] < reach.size[b]) {
+        int swap = a;
+        a = b;
+        b = swap;
     }
-   
-    return 0;
+    reach.parent[b] = a;
+    reach.size[a] += reach.size[b];
 }
 
-void UpdateSnake() {
-    if (paused) return;
-    Position newHead = { snake.body[0].x + snake.dx, snake.body[0].y + snake.dy };
-   
-    // In infinite mode, wrap around screen instead of dying
-    if (currentMode == INFINITE) {
-        if (newHead.x < 0) newHead.x = SCREEN_WIDTH - GRID_SIZE;
-        if (newHead.x >= SCREEN_WIDTH) newHead.x = 0;
-        if (newHead.y < NAV_BAR_HEIGHT) newHead.y = SCREEN_HEIGHT - GRID_SIZE;
-        if (newHead.y >= SCREEN_HEIGHT) newHead.y = NAV_BAR_HEIGHT;
-    } else {
-        // Regular wall collision for other modes
-        if (newHead.x < 0 || newHead.x >= SCREEN_WIDTH || newHead.y < NAV_BAR_HEIGHT || newHead.y >= SCREEN_HEIGHT) {
-            running = 0;
+int NewRegionLabel(int size) {
+    int label = reach.nextLabel++;
+    reach.parent[label] = label;
+    reach.size[label] = size;
+    return label;
+}
+
+// Labels the whole board from scratch in one pass, no flood fill
+void ResetReach() {
+    reach.wrap = currentMode == INFINITE;
+    reach.nextLabel = 1;
+    for (int cell = 0; cell < BOARD_CELLS; cell++) {
+        for (int d = 0; d < 4; d++) {
+            reach.next[cell][d] = ReachOffset(cell, reachDx[d], reachDy[d]);
         }
+        reach.labelAt[cell] = CellBlocked(cell) ? 0 : NewRegionLabel(1);
     }
-   
-    // Phantom wall collision (only in Challenge mode)
-    if (currentMode == CHALLENGE && IsPointOnPhantomWall(newHead.x, newHead.y)) {
-        running = 0;
+    for (int cell = 0; cell < BOARD_CELLS; cell++) {
+        if (reach.labelAt[cell] == 0) continue;
+        int right = reach.next[cell][0];
+        int down = reach.next[cell][1];
+        if (right >= 0 && reach.labelAt[right] != 0) JoinRegions(reach.labelAt[cell], reach.labelAt[right]);
+        if (down >= 0 && reach.labelAt[down] != 0) JoinRegions(reach.labelAt[cell], reach.labelAt[down]);
     }
-   
-    // Self collision (disabled in infinite mode when length is below 20)
-    if (currentMode != INFINITE || (currentMode == INFINITE && snake.length >= 20)) {
-        for (int i = 1; i < snake.length; i++) {
-            if (newHead.x == snake.body[i].x && newHead.y == snake.body[i].y) {
-                running = 0;
-            }
-        }
+    reach.valid = 1;
+}
+
+int SearchSide(int* side, int s) {
+    while (side[s] != s) s = side[s];
+    return s;
+}
+
+// Searches out from each side of a newly blocked cell, one cell per side in
+// turn. Sides that meet are still one region; a side that runs dry first is
+// sealed off and takes a new label, the rest keep the old one.
+void SplitRegions(const int* seeds, int sides) {
+    static _Thread_local unsigned int seen[BOARD_CELLS];  // Search stamp plus side
+    static _Thread_local unsigned int stamp = 0;
+    static _Thread_local Cell queue[4][BOARD_CELLS];
+    int head[4], tail[4], side[4], sealed[4];
+    if (stamp > UINT_MAX - 8) {
+        memset(seen, 0, sizeof(seen));
+        stamp = 0;
     }
-   
-    // Rest of the function remains the same...
-    // Move snake
-    for (int i = snake.length - 1; i > 0; i--) {
-        snake.body[i] = snake.body[i - 1];
+    unsigned int base = stamp + 1;
+    stamp += 4;
+    int root = FindRegion(reach.labelAt[seeds[0]]);
+    for (int s = 0; s < sides; s++) {
+        head[s] = 0;
+        tail[s] = 1;
+        queue[s][0] = seeds[s];
+        seen[seeds[s]] = base + s;
+        side[s] = s;
+        sealed[s] = 0;
     }
-    snake.body[0] = newHead;
    
-    // Eat food
-    if (newHead.x == food.x && newHead.y == food.y) {
-        if (snake.length < SNAKE_MAX_LENGTH) {
-            snake.length++;
+    int groups = sides;
+    while (groups > 1) {
+        int dried = 0;
+        for (int s = 0; s < sides; s++) {
+            if (head[s] == tail[s]) continue;
+            Cell cell = queue[s][head[s]++];
+            for (int d = 0; d < 4; d++) {
+                int next = reach.next[cell][d];
+                if (next < 0 || reach.labelAt[next] == 0) continue;
+                if (seen[next] < base) {
+                    seen[next] = base + s;
+                    queue[s][tail[s]++] = next;
+                } else if (seen[next] != base + s) {
+                    int a = SearchSide(side, s), b = SearchSide(side, seen[next] - base);
+                    if (a != b) {
+                        side[b] = a;
+                        groups--;
+                    }
+                }
+            }
+            dried |= head[s] == tail[s];
         }
-        SpawnFood();
-        if (speed > 40) {
-            if (currentMode == CLASSIC || currentMode == INFINITE) {
-                speed -= 2;
-            } else {
-                speed -= 5;
+        if (!dried) continue;
+       
+        for (int g = 0; g < sides && groups > 1; g++) {
+            if (sealed[g] || SearchSide(side, g) != g) continue;
+            int dry = 1, count = 0;
+            for (int s = 0; s < sides; s++) {
+                if (SearchSide(side, s) != g) continue;
+                if (head[s] < tail[s]) dry = 0;
+                count += tail[s];
+            }
+            if (!dry) continue;
+           
+            int label = NewRegionLabel(count);
+            for (int s = 0; s < sides; s++) {
+                if (SearchSide(side, s) != g) continue;
+                for (int i = 0; i < tail[s]; i++) reach.labelAt[queue[s][i]] = label;
             }
+            reach.size[root] -= count;
+            sealed[g] = 1;
+            groups--;
         }
     }
+}
+
+// Call once a free cell has become blocked
+void ReachBlock(Cell cell) {
+    if (!reach.valid) return;
+    if (reach.nextLabel > REACH_LABELS - 5) {
+        ResetReach();  // Out of labels; relabelling hands them all back
+        return;
+    }
+    reach.size[FindRegion(reach.labelAt[cell])]--;
+    reach.labelAt[cell] = 0;
    
-    // Eat golden fruit
-    if (currentMode == CHALLENGE && goldenActive && newHead.x == goldenFruit.x && newHead.y == goldenFruit.y) {
-        if (snake.length < SNAKE_MAX_LENGTH - 3) {
-            snake.length += 3;
+    // Walk the 8 surrounding cells in a circle starting on a blocked one. Each
+    // run of free cells is connected around the cell; only several runs that
+    // touch its sides can have been joined through it alone.
+    const int* next = reach.next[cell];
+    int ring[8], first = -1;
+    ring[0] = next[3];
+    ring[2] = next[0];
+    ring[4] = next[1];
+    ring[6] = next[2];
+    ring[1] = ring[0] >= 0 ? reach.next[ring[0]][0] : -1;  // Diagonals are off the board with either side
+    ring[3] = ring[2] >= 0 ? reach.next[ring[2]][1] : -1;
+    ring[5] = ring[4] >= 0 ? reach.next[ring[4]][2] : -1;
+    ring[7] = ring[6] >= 0 ? reach.next[ring[6]][3] : -1;
+    for (int i = 0; i < 8; i++) {
+        if (ring[i] >= 0 && reach.labelAt[ring[i]] == 0) ring[i] = -1;
+        if (ring[i] < 0 && first < 0) first = i;
+    }
+    if (first < 0) return;
+   
+    int seeds[4], sides = 0, runSeeded = 0;
+    for (int k = 1; k <= 8; k++) {
+        int i = (first + k) % 8;
+        if (ring[i] < 0) {
+            runSeeded = 0;
+        } else if (i % 2 == 0 && !runSeeded) {
+            seeds[sides++] = ring[i];
+            runSeeded = 1;
         }
-        goldenActive = 0;
-        if (speed > 30) speed -= 10;
     }
+    if (sides > 1) SplitRegions(seeds, sides);
 }
 
-void HandleFrontPageInput() {
-    Vector2 mousePoint = GetMousePosition();
-   
-    // Check if start button is hovered
-    if (CheckCollisionPointRec(mousePoint, startButton.rect)) {
-        startButton.hover = true;
-        if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
-            currentState = MENU;
-        }
-    } else {
-        startButton.hover = false;
+// Call once a blocked cell has become free
+void ReachFree(Cell cell) {
+    if (!reach.valid) return;
+    if (reach.nextLabel > REACH_LABELS - 5) {
+        ResetReach();
+        return;
+    }
+    int label = reach.labelAt[cell] = NewRegionLabel(1);
+    for (int d = 0; d < 4; d++) {
+        int next = reach.next[cell][d];
+        if (next >= 0 && reach.labelAt[next] != 0) JoinRegions(label, reach.labelAt[next]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Maze levels. A level file is mapped, never parsed: a header, one byte per
+// cell and the step count of the shortest path between every pair of cells,
+// worked out once when the level is built. Food placement and autopilots read
+// distances straight from the mapping, and only the pages they touch are ever
+// loaded. Level walls are added to the same per-cell wall counts as phantom
+// walls, so movement, collisions and reachability treat both alike.
+// ---------------------------------------------------------------------------
+
+// Used when the default level file is missing; '>' '<' 'v' '^' mark the start
+const char* builtInMaze[] = {
+    "########################################",
+    "#......................................#",
+    "#......................................#",
+    "#..######..#######....#######..######..#",
+    "#..#...................................#",
+    "#..#...................................#",
+    "#..#...#######....######....#######..#.#",
+    "#......#......................#......#.#",
+    "#......#......................#......#.#",
+    "####...#...######....######...#...####.#",
+    "#..............#........#..............#",
+    "#..............#........#..............#",
+    "#..>....####...#........#...####.......#",
+    "#..............#........#..............#",
+    "#..............#........#..............#",
+    "####...#...######....######...#...####.#",
+    "#......#......................#......#.#",
+    "#......#......................#......#.#",
+    "#..#...#######....######....#######..#.#",
+    "#..#...................................#",
+    "#..#...................................#",
+    "#..######..#######....#######..######..#",
+    "#......................................#",
+    "#......................................#",
+    "#......................................#",
+    "########################################",
+};
+
+size_t LevelDistanceOffset() {
+    return sizeof(LevelHeader) + ((BOARD_CELLS + 1) & ~1);  // Keeps the distances 2-byte aligned
+}
+
+size_t LevelFileSize() {
+    return LevelDistanceOffset() + (size_t)BOARD_CELLS * BOARD_CELLS * sizeof(unsigned short);
+}
+
+unsigned int LevelChecksum(const LevelHeader* header, const unsigned char* walls) {
+    int start[3] = { (int)header->start, header->startDx, header->startDy };
+    const unsigned char* bytes = (const unsigned char*)start;
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(start); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
     }
+    for (int i = 0; i < BOARD_CELLS; i++) {
+        hash = (hash ^ walls[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Turns a text layout into a level file: '#' is wall, anything else open
+int BuildLevel(const char* const* lines, int lineCount, const char* path) {
+    static unsigned char walls[BOARD_CELLS];
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKL", 4);
+    header.version = LEVEL_VERSION;
+    header.cols = BOARD_COLS;
+    header.rows = BOARD_ROWS;
+    header.start = BOARD_CELLS;
    
-    // Check if exit button is hovered
-    if (CheckCollisionPointRec(mousePoint, exitButton.rect)) {
-        exitButton.hover = true;
-        if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
-            CloseWindow();
+    // Rows or columns missing from the layout are open floor
+    memset(walls, 0, sizeof(walls));
+    if (lineCount > BOARD_ROWS) {
+        fprintf(stderr, "Level has %d rows, the board has %d\n", lineCount, BOARD_ROWS);
+        return 0;
+    }
+    for (int y = 0; y < lineCount; y++) {
+        int length = (int)strcspn(lines[y], "\r\n");
+        if (length > BOARD_COLS) {
+            fprintf(stderr, "Level row %d has %d columns, the board has %d\n", y + 1, length, BOARD_COLS);
+            return 0;
+        }
+        for (int x = 0; x < length; x++) {
+            static const char arrows[] = "><v^";
+            static const int arrowDx[4] = { 1, -1, 0, 0 };
+            static const int arrowDy[4] = { 0, 0, 1, -1 };
+            const char* arrow = strchr(arrows, lines[y][x]);
+            walls[y * BOARD_COLS + x] = lines[y][x] == '#';
+            if (arrow != NULL) {
+                header.start = y * BOARD_COLS + x;
+                header.startDx = arrowDx[arrow - arrows];
+                header.startDy = arrowDy[arrow - arrows];
+            }
         }
-    } else {
-        exitButton.hover = false;
     }
    
-    // Start game with Enter or Space key
-    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
-        currentState = MENU;
+    // The tail starts one step behind the head, so both cells must be open
+    int tailX = header.start % BOARD_COLS - header.startDx;
+    int tailY = header.start / BOARD_COLS - header.startDy;
+    if (header.start >= BOARD_CELLS || tailX < 0 || tailX >= BOARD_COLS || tailY < 0 || tailY >= BOARD_ROWS ||
+        walls[tailY * BOARD_COLS + tailX]) {
+        fprintf(stderr, "Level needs a start arrow (> < v ^) with an open cell behind it\n");
+        return 0;
     }
+    header.checksum = LevelChecksum(&header, walls);
    
-    // Exit with Escape key - quit the game
-    if (IsKeyPressed(KEY_ESCAPE)) {
-        CloseWindow();
+    char temp[512];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not write %s\n", temp);
+        return 0;
     }
-}
-
-void HandleMenuInput() {
-    Vector2 mousePoint = GetMousePosition();
+    static const unsigned char padding[2] = { 0, 0 };
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(walls, 1, BOARD_CELLS, file) == BOARD_CELLS &&
+             fwrite(padding, 1, LevelDistanceOffset() - sizeof(header) - BOARD_CELLS, file) ==
+                 LevelDistanceOffset() - sizeof(header) - BOARD_CELLS;
    
-    for (int i = 0; i < numOptions; i++) {
-        if (CheckCollisionPointRec(mousePoint, menuButtons[i].rect)) {
-            menuButtons[i].hover = true;
-            if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
-                selectedOption = i;
-                selectedMode = (GameMode)i;
-                currentState = COUNTDOWN;
-                countdownTimer = COUNTDOWN_DURATION;
+    // One breadth-first search per cell fills in that cell's row of distances
+    static unsigned short distances[BOARD_CELLS];
+    static int queue[BOARD_CELLS];
+    for (int source = 0; source < BOARD_CELLS && ok; source++) {
+        for (int i = 0; i < BOARD_CELLS; i++) distances[i] = LEVEL_UNREACHABLE;
+        int head = 0, tail = 0;
+        if (!walls[source]) {
+            distances[source] = 0;
+            queue[tail++] = source;
+        }
+        while (head < tail) {
+            int cell = queue[head++];
+            int x = cell % BOARD_COLS, y = cell / BOARD_COLS;
+            for (int d = 0; d < 4; d++) {
+                int nx = x + reachDx[d], ny = y + reachDy[d];
+                if (nx < 0 || nx >= BOARD_COLS || ny < 0 || ny >= BOARD_ROWS) continue;
+                int next = ny * BOARD_COLS + nx;
+                if (walls[next] || distances[next] != LEVEL_UNREACHABLE) continue;
+                distances[next] = distances[cell] + 1;
+                queue[tail++] = next;
             }
-        } else {
-            menuButtons[i].hover = false;
         }
+        ok = fwrite(distances, sizeof(unsigned short), BOARD_CELLS, file) == BOARD_CELLS;
     }
+    ok = fflush(file) == 0 && ok;
+    fclose(file);
+    if (!ok) {
+        remove(temp);
+        fprintf(stderr, "Could not write %s\n", temp);
+        return 0;
+    }
+#ifdef _WIN32
+    remove(path);
+#endif
+    rename(temp, path);
+    return 1;
+}
 
-    if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
-        selectedOption = (selectedOption + 1) % numOptions;
+int BuildLevelFromText(const char* layoutPath, const char* path) {
+    FILE* file = fopen(layoutPath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", layoutPath);
+        return 1;
     }
-   
-    if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
-        selectedOption = (selectedOption - 1 + numOptions) % numOptions;
+    static char text[BOARD_ROWS + 1][256];
+    const char* lines[BOARD_ROWS + 1];
+    int count = 0;
+    while (count <= BOARD_ROWS && fgets(text[count], sizeof(text[count]), file) != NULL) {
+        lines[count] = text[count];
+        count++;
     }
+    fclose(file);
+    while (count > 0 && strcspn(lines[count - 1], "\r\n") == 0) count--;  // Trailing blank lines
+    if (!BuildLevel(lines, count, path)) return 1;
+    printf("Wrote %s (%zu bytes)\n", path, LevelFileSize());
+    return 0;
+}
+
+void UnloadLevel() {
+    if (level == NULL) return;
+#ifndef _WIN32
+    munmap((void*)level, LevelFileSize());
+#else
+    free((void*)level);
+#endif
+    level = NULL;
+    levelWalls = NULL;
+    levelDistances = NULL;
+}
+
+// Maps path as the maze level unless it already is; the default level is built on first use
+int LoadLevel(const char* path) {
+    if (level != NULL && strcmp(path, levelLoaded) == 0) return 1;
+    UnloadLevel();
+    double start = MonotonicSeconds();
+    size_t size = LevelFileSize();
+    const LevelHeader* header = NULL;
    
-    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
-        selectedMode = (GameMode)selectedOption;
-        currentState = COUNTDOWN;
-        countdownTimer = COUNTDOWN_DURATION;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 && strcmp(path, MAZE_LEVEL_FILE) == 0 &&
+        BuildLevel(builtInMaze, sizeof(builtInMaze) / sizeof(builtInMaze[0]), path)) {
+        fd = open(path, O_RDONLY);
+    }
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size == (off_t)size) {
+        header = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (header == MAP_FAILED) header = NULL;
+    }
+    close(fd);
+#else
+    FILE* file = fopen(path, "rb");
+    if (file == NULL && strcmp(path, MAZE_LEVEL_FILE) == 0 &&
+        BuildLevel(builtInMaze, sizeof(builtInMaze) / sizeof(builtInMaze[0]), path)) {
+        file = fopen(path, "rb");
     }
+    if (file == NULL) return 0;
+    void* data = malloc(size);
+    if (data != NULL && fread(data, size, 1, file) == 1) header = data;
+    else free(data);
+    fclose(file);
+#endif
+    if (header == NULL) return 0;
    
-    // ESC goes back to front page
-    if (IsKeyPressed(KEY_ESCAPE)) {
-        currentState = FRONT_PAGE;
+    // Distances are only ever compared, so the header and walls are all that need checking
+    level = header;
+    levelWalls = (const unsigned char*)header + sizeof(LevelHeader);
+    levelDistances = (const unsigned short*)((const unsigned char*)header + LevelDistanceOffset());
+    if (memcmp(header->magic, "SNKL", 4) != 0 || header->version != LEVEL_VERSION ||
+        header->cols != BOARD_COLS || header->rows != BOARD_ROWS || header->start >= BOARD_CELLS ||
+        abs(header->startDx) + abs(header->startDy) != 1 || header->checksum != LevelChecksum(header, levelWalls)) {
+        UnloadLevel();
+        return 0;
     }
+    snprintf(levelLoaded, sizeof(levelLoaded), "%s", path);
+    TraceLog(LOG_INFO, "Mapped level %s in %.3f ms", path, (MonotonicSeconds() - start) * 1000.0);
+    return 1;
 }
 
-void HandleGameInput() {
-    if (IsKeyPressed(KEY_P)) {
-        paused = !paused;
+// Steps along the shortest open path from cell to every other cell
+const unsigned short* LevelDistancesFrom(Cell cell) {
+    return levelDistances + (size_t)cell * BOARD_CELLS;
+}
+
+// Adds the level's walls to the wall counts; only Maze mode has any
+void StampLevelWalls() {
+    if (currentMode != MAZE || level == NULL) return;
+    for (int cell = 0; cell < BOARD_CELLS; cell++) {
+        entities.wallsAt[cell] += levelWalls[cell];
     }
-    if (!paused) {
-        if ((IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) && snake.dy == 0) {
-            snake.dx = 0;
-            snake.dy = -GRID_SIZE;
-        }
-        if ((IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) && snake.dy == 0) {
-            snake.dx = 0;
-            snake.dy = GRID_SIZE;
-        }
-        if ((IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) && snake.dx == 0) {
-            snake.dx = -GRID_SIZE;
-            snake.dy = 0;
-        }
-        if ((IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) && snake.dx == 0) {
-            snake.dx = GRID_SIZE;
-            snake.dy = 0;
-        }
+}
+
+// ---------------------------------------------------------------------------
+// Snake body storage. Segment i is stream position headSeq - i, so moving is
+// one append at the head and growing is simply not dropping the tail. Chunks
+// are taken from the arena as the head enters them and handed back as the
+// tail leaves them; InitSnake returns them all at once.
+// ---------------------------------------------------------------------------
+
+// Records a cell the board shader must redraw; the count saturates just past the limit
+static inline void MarkBoardCell(Cell cell) {
+    if (boardChangeCount < BOARD_CHANGES_MAX) boardChanges[boardChangeCount] = cell;
+    if (boardChangeCount <= BOARD_CHANGES_MAX) boardChangeCount++;
+}
+
+// For bulk changes (new game, loaded save) that are cheaper to redraw whole
+void MarkBoardAll() {
+    boardChangeCount = BOARD_CHANGES_MAX + 1;
+}
+
+// Connectivity only changes when the first segment arrives on a cell or the last one leaves
+void AddBodyCell(Cell cell) {
+    if (snake.bodyAt[cell]++ == 0 && entities.wallsAt[cell] == 0) ReachBlock(cell);
+    MarkBoardCell(cell);
+}
+
+void RemoveBodyCell(Cell cell) {
+    if (--snake.bodyAt[cell] == 0 && entities.wallsAt[cell] == 0) ReachFree(cell);
+    MarkBoardCell(cell);
+}
+
+Cell* BodySlot(unsigned int seq) {
+    return &snake.chunks[(seq / BODY_CHUNK_CELLS) % BODY_CHUNKS][seq % BODY_CHUNK_CELLS];
+}
+
+// Segment i of the snake, 0 being the head
+Cell SnakeCell(int i) {
+    return *BodySlot(snake.headSeq - i);
+}
+
+// Grows the snake by one segment at the head
+void PushSnakeHead(Cell cell) {
+    unsigned int seq = ++snake.headSeq;
+    if (seq % BODY_CHUNK_CELLS == 0) {
+        snake.chunks[(seq / BODY_CHUNK_CELLS) % BODY_CHUNKS] = bodyFree[--bodyFreeCount];
     }
-   
-    // Q key - go back to menu
-    if (IsKeyPressed(KEY_Q)) {
-        currentState = MENU;
+    *BodySlot(seq) = cell;
+    AddBodyCell(cell);
+    snake.length++;
+}
+
+void DropSnakeTail() {
+    unsigned int tailSeq = snake.headSeq - snake.length + 1;
+    RemoveBodyCell(*BodySlot(tailSeq));
+    snake.length--;
+    if ((tailSeq + 1) % BODY_CHUNK_CELLS == 0) {
+        bodyFree[bodyFreeCount++] = snake.chunks[snake.tailChunk % BODY_CHUNKS];
+        snake.tailChunk++;
     }
-    
-    // ESC key - quit the game completely
-    if (IsKeyPressed(KEY_ESCAPE)) {
-        CloseWindow();
+}
+
+// Grows the snake by one segment behind the tail
+void AppendSnakeTail(Cell cell) {
+    unsigned int seq = snake.headSeq - snake.length;
+    if ((seq + 1) % BODY_CHUNK_CELLS == 0) {
+        snake.tailChunk--;
+        snake.chunks[snake.tailChunk % BODY_CHUNKS] = bodyFree[--bodyFreeCount];
     }
+    *BodySlot(seq) = cell;
+    AddBodyCell(cell);
+    snake.length++;
 }
 
-void HandleGameOverInput() {
-    // ENTER or SPACE - return to menu
-    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
-        currentState = MENU;
+// Stacks count more segments on the tail cell, which unfold as the snake moves on
+void ExtendSnakeTail(int count) {
+    Cell tail = SnakeCell(snake.length - 1);
+    for (int i = 0; i < count; i++) {
+        AppendSnakeTail(tail);
     }
-    
-    // Q key - also go back to menu
-    if (IsKeyPressed(KEY_Q)) {
-        currentState = MENU;
+}
+
+// Undoes PushSnakeHead
+void PopSnakeHead() {
+    unsigned int seq = snake.headSeq--;
+    RemoveBodyCell(*BodySlot(seq));
+    if (snake.bodyAt[*BodySlot(seq)] > 0) MarkBoardAll();  // An older segment shows through; its stamp is unknown
+    snake.length--;
+    if (seq % BODY_CHUNK_CELLS == 0) {
+        bodyFree[bodyFreeCount++] = snake.chunks[(seq / BODY_CHUNK_CELLS) % BODY_CHUNKS];
     }
-    
-    // ESC key - quit the game completely
-    if (IsKeyPressed(KEY_ESCAPE)) {
-        CloseWindow();
+}
+
+// Releases the whole body back to the arena and leaves an empty snake
+void ClearSnakeBody() {
+    for (int i = 0; i < BODY_CHUNKS; i++) {
+        bodyFree[i] = bodyArena[i];
     }
+    bodyFreeCount = BODY_CHUNKS;
+    memset(snake.bodyAt, 0, sizeof(snake.bodyAt));
+    MarkBoardAll();
+    reach.valid = 0;
+    snake.length = 0;
+    snake.headSeq = (unsigned int)-1;  // The first push starts chunk 0
+    snake.tailChunk = 0;
 }
 
-void UpdateCountdown(float deltaTime) {
-    countdownTimer -= deltaTime;
-    if (countdownTimer <= 0) {
-        ResetGame();
-        currentState = GAME;
+void InitSnake() {
+    ClearSnakeBody();
+    if (currentMode == MAZE && level != NULL) {
+        PushSnakeHead(level->start - level->startDy * BOARD_COLS - level->startDx);
+        PushSnakeHead(level->start);
+        snake.dx = level->startDx;
+        snake.dy = level->startDy;
+        return;
     }
+    int center = (BOARD_ROWS / 2) * BOARD_COLS + BOARD_COLS / 2;
+    PushSnakeHead(center - 1);
+    PushSnakeHead(center);
+    snake.dx = 1;
+    snake.dy = 0;
 }
 
-void UpdateGame(float deltaTime) {
-    if (currentMode == TIME_ATTACK && !paused) {
-        timeAttackTimer -= deltaTime;
-        if (timeAttackTimer <= 0) {
-            running = 0;
+int TuningInBounds(const Tuning* t) {
+    if (t->baseSpeed < 10 || t->baseSpeed > 1000) return 0;
+    if (t->goldenSpeedStep < 0 || t->goldenSpeedStep > MAX_SPEED_STEP) return 0;
+    for (int mode = 0; mode <= MAZE; mode++) {
+        if (t->foodSpeedStep[mode] < 0 || t->foodSpeedStep[mode] > MAX_SPEED_STEP) return 0;
+        if (t->foodTarget[mode] < 1 || t->foodTarget[mode] > MAX_PICKUPS - MAX_GOLDEN_FRUITS) return 0;
+    }
+    if (t->goldenMax < 0 || t->goldenMax > MAX_GOLDEN_FRUITS || t->wallMax < 1 || t->wallMax > MAX_PHANTOM_WALLS) return 0;
+    // Written so that NaN fails too
+    return t->wallInterval > 0 && t->wallInterval <= 3600 && t->wallDuration > 0 && t->wallDuration <= 3600 &&
+           t->timeAttackDuration > 0 && t->timeAttackDuration <= 3600 && t->goldenLife >= 0 &&
+           t->goldenLife <= 3600 && t->wallRamp >= 0 && t->wallRamp <= 1;
+}
+
+// Sets one knob by its tuningNames name; "step" and "food" apply to every mode. Returns 0 for an unknown name
+int SetTuning(Tuning* t, const char* name, float value) {
+    if (strcmp(name, "speed") == 0) {
+        t->baseSpeed = (int)value;
+    } else if (strcmp(name, "step") == 0) {
+        for (int mode = 0; mode <= MAZE; mode++) t->foodSpeedStep[mode] = (int)value;
+    } else if (strcmp(name, "golden-step") == 0) {
+        t->goldenSpeedStep = (int)value;
+    } else if (strcmp(name, "wall-interval") == 0) {
+        t->wallInterval = value;
+    } else if (strcmp(name, "wall-duration") == 0) {
+        t->wallDuration = value;
+    } else if (strcmp(name, "time") == 0) {
+        t->timeAttackDuration = value;
+    } else if (strcmp(name, "food") == 0) {
+        for (int mode = 0; mode <= MAZE; mode++) t->foodTarget[mode] = (int)value;
+    } else if (strcmp(name, "golden") == 0) {
+        t->goldenMax = (int)value;
+    } else if (strcmp(name, "golden-life") == 0) {
+        t->goldenLife = value;
+    } else if (strcmp(name, "walls") == 0) {
+        t->wallMax = (int)value;
+    } else if (strcmp(name, "wall-ramp") == 0) {
+        t->wallRamp = value;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// --tune name=value
+int ParseTuning(Tuning* t, const char* assignment) {
+    char name[32];
+    const char* equals = strchr(assignment, '=');
+    if (equals != NULL && equals - assignment < (int)sizeof(name)) {
+        memcpy(name, assignment, equals - assignment);
+        name[equals - assignment] = '\0';
+        Tuning changed = *t;
+        if (SetTuning(&changed, name, (float)atof(equals + 1)) && TuningInBounds(&changed)) {
+            *t = changed;
+            return 1;
         }
     }
+    fprintf(stderr, "Bad tuning %s; expected one of", assignment);
+    for (int i = 0; i < (int)(sizeof(tuningNames) / sizeof(tuningNames[0])); i++) {
+        fprintf(stderr, " %s", tuningNames[i]);
+    }
+    fprintf(stderr, " set to a value in range\n");
+    return 0;
+}
+
+void ResetGame() {
+    running = 1;
+    paused = 0;
+    tuning = playTuning;
+    speed = tuning.baseSpeed;
+    timeAttackTimer = tuning.timeAttackDuration;
+    currentMode = selectedMode;
+    if (currentMode == MAZE && !LoadLevel(levelPath)) {
+        TraceLog(LOG_WARNING, "Could not load level %s, playing Classic instead", levelPath);
+        currentMode = selectedMode = CLASSIC;
+    }
+    gameClock = 0;
+    lastUpdateTime = 0;
+    gameRng = SeedRandom((unsigned int)time(NULL));
+    InitSnake();
+    ResetEntities();
+    ClearParticles();
+    canvasValid = 0;
+    if (currentMode == ARENA) {
+        InitArena();
+    }
+    SelectModeKernel();
+    ClearRewind();
+    StartReplayRecording();
+}
+
+// ---------------------------------------------------------------------------
+// Pickups and hazards. Every entity registers its cells in a per-cell lookup,
+// so the snake checks its new head with two array reads; spawning and expiry
+// happen in one batch pass per update instead of inside the movement code.
+// ---------------------------------------------------------------------------
+
+// Regions the head can step into; returns the free cells they hold between them
+int HeadRegions(int* regions, int* count) {
+    int cells = 0;
+    *count = 0;
+    for (int d = 0; d < 4; d++) {
+        int next = reach.next[SnakeCell(0)][d];
+        if (next < 0 || reach.labelAt[next] == 0) continue;
+        int region = FindRegion(reach.labelAt[next]);
+        int known = 0;
+        for (int i = 0; i < *count; i++) known |= regions[i] == region;
+        if (known) continue;
+        regions[(*count)++] = region;
+        cells += reach.size[region];
+    }
+    return cells;
+}
+
+int InRegions(Cell cell, const int* regions, int count) {
+    if (reach.labelAt[cell] == 0) return 0;
+    int region = FindRegion(reach.labelAt[cell]);
+    for (int i = 0; i < count; i++) {
+        if (regions[i] == region) return 1;
+    }
+    return 0;
+}
+
+int ReachablePickups() {
+    int regions[4], count;
+    HeadRegions(regions, &count);
+    int reachable = 0;
+    for (int i = 0; i < entities.pickupCount; i++) {
+        reachable += InRegions(entities.pickupCell[i], regions, count);
+    }
+    return reachable;
+}
+
+// Free, reachable, not under another pickup and, given level distances, at least minSteps away
+int SpawnCellOk(Cell cell, const int* regions, int regionCount, const unsigned short* steps, int minSteps) {
+    return entities.pickupAt[cell] == 0 && InRegions(cell, regions, regionCount) &&
+           (steps == NULL || steps[cell] >= minSteps);
+}
+
+int AddPickup(int kind, float life, int minSteps) {
+    if (entities.pickupCount >= MAX_PICKUPS) return -1;
+    double traceStart = TraceBegin();
+    int regions[4], regionCount;
+    int reachable = HeadRegions(regions, &regionCount);
+    const unsigned short* steps = minSteps > 0 && level != NULL ? LevelDistancesFrom(SnakeCell(0)) : NULL;
    
-    if (currentMode == CHALLENGE && !paused) {
-        if (phantomWall.active) {
-            phantomWall.timer -= deltaTime;
-           
-            // Update countdown display (3, 2, 1)
-            int currentCountdown = (int)ceil(phantomWall.timer);
-            if (currentCountdown != phantomWall.countdown && currentCountdown >= 0 && currentCountdown <= 3) {
-                phantomWall.countdown = currentCountdown;
-            }
-           
-            if (phantomWall.timer <= 0) {
-                phantomWall.active = 0;
+    // Only on free cells the head can reach, never stacked on another pickup
+    Cell cell = 0;
+    int tries = 0, found = 0;
+    do {
+        cell = SimRandomRange(&gameRng, 0, BOARD_CELLS - 1);
+        found = SpawnCellOk(cell, regions, regionCount, steps, minSteps);
+    } while (!found && ++tries < 16);
+   
+    // A crowded or walled-in board: choose among the qualifying cells directly
+    if (!found) {
+        int open = 0;
+        if (steps != NULL) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) open += SpawnCellOk(cell, regions, regionCount, steps, minSteps);
+            if (open == 0) steps = NULL;  // Nothing is far enough; any reachable cell will do
+        }
+        if (steps == NULL) {
+            open = reachable;
+            for (int i = 0; i < entities.pickupCount; i++) {
+                open -= InRegions(entities.pickupCell[i], regions, regionCount);
             }
-        } else {
-            phantomWallTimer += deltaTime;
-            if (phantomWallTimer >= PHANTOM_WALL_INTERVAL) {
-                GeneratePhantomWall();
-                phantomWallTimer = 0;
+        }
+        if (open > 0) {
+            int pick = SimRandom(&gameRng) % open;
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                if (SpawnCellOk(cell, regions, regionCount, steps, minSteps) && pick-- == 0) break;
             }
+            found = 1;
         }
     }
+    TraceSpan("AddPickup", traceStart, "retries", tries);
+    if (!found) return -1;
    
-    double currentTime = GetTime();
-    if (currentTime - lastUpdateTime > speed / 1000.0) {
-        UpdateSnake();
-        lastUpdateTime = currentTime;
-    }
+    int slot = entities.pickupCount++;
+    entities.pickupCell[slot] = cell;
+    entities.pickupKind[slot] = kind;
+    entities.pickupLife[slot] = life;
+    entities.pickupAt[cell] = slot + 1;
+    MarkBoardCell(cell);
+    if (kind == PICKUP_GOLDEN) entities.goldenCount++;
+    else entities.foodCount++;
+    return slot;
+}
+
+// Swap-removes, so the live pickups stay packed at the front of the arrays
+void RemovePickup(int slot) {
+    if (entities.pickupKind[slot] == PICKUP_GOLDEN) entities.goldenCount--;
+    else entities.foodCount--;
+    entities.pickupAt[entities.pickupCell[slot]] = 0;
+    MarkBoardCell(entities.pickupCell[slot]);
    
-    if (!running && currentMode != INFINITE) {
-        currentState = GAME_OVER;
+    int last = --entities.pickupCount;
+    if (slot != last) {
+        entities.pickupCell[slot] = entities.pickupCell[last];
+        entities.pickupKind[slot] = entities.pickupKind[last];
+        entities.pickupLife[slot] = entities.pickupLife[last];
+        entities.pickupAt[entities.pickupCell[slot]] = slot + 1;
     }
 }
 
-void RenderFrontPage() {
-    BeginDrawing();
-    ClearBackground(bgColor);
+// Connectivity only changes when the first wall covers a cell or the last one lifts
+void CoverWallCell(Cell cell) {
+    if (entities.wallsAt[cell]++ == 0 && snake.bodyAt[cell] == 0) ReachBlock(cell);
+    MarkBoardCell(cell);
+}
 
-    // SNAKESCAPE title with glow effect
-    const char* gameTitle = "SNAKESCAPE";
-    int titleSize = 70;
-    int titleY = 120;
-    
-    // Glow effect for title
-    for (int i = 5; i > 0; i--) {
-        Color glowColor = accentColor1;
-        glowColor.a = 30 + 10 * i;
-        DrawText(gameTitle, 
-                 SCREEN_WIDTH / 2 - MeasureText(gameTitle, titleSize) / 2 + i/2, 
-                 titleY - i/2, 
-                 titleSize, 
-                 glowColor);
-        DrawText(gameTitle, 
-                 SCREEN_WIDTH / 2 - MeasureText(gameTitle, titleSize) / 2 - i/2, 
-                 titleY - i/2, 
-                 titleSize, 
-                 glowColor);
-    }
-    
-    // Main title
-    DrawText(gameTitle,
-             SCREEN_WIDTH / 2 - MeasureText(gameTitle, titleSize) / 2,
-             titleY,
-             titleSize,
-             accentColor1);
+void UncoverWallCell(Cell cell) {
+    if (--entities.wallsAt[cell] == 0 && snake.bodyAt[cell] == 0) ReachFree(cell);
+    MarkBoardCell(cell);
+}
 
-    // Subtitle "Hunt. Grow. Survive." with color gradient
-    const char* subtitle = "Hunt. Grow. Survive.";
-    int subtitleSize = 30;
-    int subtitleY = titleY + 80;
-    
-    // Glow effect for subtitle
-    for (int i = 3; i > 0; i--) {
-        Color glowColor = accentColor2;
-        glowColor.a = 40;
-        DrawText(subtitle,
-                 SCREEN_WIDTH / 2 - MeasureText(subtitle, subtitleSize) / 2 + i/2,
-                 subtitleY - i/2,
-                 subtitleSize,
-                 glowColor);
+void RemovePhantomWall(int w) {
+    for (int i = 0; i < entities.wallCellCount[w]; i++) {
+        UncoverWallCell(entities.wallCells[w][i]);
     }
-    
-    // Main subtitle
-    DrawText(subtitle,
-             SCREEN_WIDTH / 2 - MeasureText(subtitle, subtitleSize) / 2,
-             subtitleY,
-             subtitleSize,
-             accentColor2);
+   
+    int last = --entities.wallCount;
+    if (w != last) {
+        entities.wallStart[w] = entities.wallStart[last];
+        entities.wallEnd[w] = entities.wallEnd[last];
+        entities.wallTimer[w] = entities.wallTimer[last];
+        entities.wallCountdown[w] = entities.wallCountdown[last];
+        entities.wallCellCount[w] = entities.wallCellCount[last];
+        memcpy(entities.wallCells[w], entities.wallCells[last], sizeof(entities.wallCells[w]));
+    }
+}
 
-    // Update button positions to be at bottom, side by side
-    int buttonWidth = 180;
-    int buttonHeight = 45;
-    int buttonSpacing = 20; // Space between buttons
-    
-    startButton.rect.x = SCREEN_WIDTH/2 - buttonWidth - buttonSpacing/2;
+Cell ClampedCell(float x, float y) {
+    int col = (int)x;
+    int row = (int)y;
+    if (col < 0) col = 0;
+    if (col >= BOARD_COLS) col = BOARD_COLS - 1;
+    if (row < 0) row = 0;
+    if (row >= BOARD_ROWS) row = BOARD_ROWS - 1;
+    return row * BOARD_COLS + col;
+}
+
+// Returns the index of the new wall, or -1 when none was placed
+int GeneratePhantomWall() {
+    if (entities.wallCount >= MAX_PHANTOM_WALLS) return -1;
+    double traceStart = TraceBegin();
+   
+    // Cut the snake off from the closest food
+    int headX = SnakeCell(0) % BOARD_COLS;
+    int headY = SnakeCell(0) / BOARD_COLS;
+    int dx = 0, dy = 0, best = -1;
+    for (int i = 0; i < entities.pickupCount; i++) {
+        if (entities.pickupKind[i] != PICKUP_FOOD) continue;
+        int fx = entities.pickupCell[i] % BOARD_COLS - headX;
+        int fy = entities.pickupCell[i] / BOARD_COLS - headY;
+        if (best < 0 || abs(fx) + abs(fy) < best) {
+            best = abs(fx) + abs(fy);
+            dx = fx;
+            dy = fy;
+        }
+    }
+   
+    float distance = sqrtf(dx*dx + dy*dy);
+    if (distance < 1) return -1;
+   
+    float ndx = dx / distance;
+    float ndy = dy / distance;
+   
+    float midPointX = roundf(headX + dx * 0.33f);
+    float midPointY = roundf(headY + dy * 0.33f);
+   
+    float perpX = -ndy;
+    float perpY = ndx;
+   
+    int reachableBefore = ReachablePickups();
+    int wallLength = 4 + snake.length / 3;
+    if (wallLength > 12) wallLength = 12;
+   
+    int w = entities.wallCount++;
+    Cell start = ClampedCell(midPointX + perpX * wallLength / 2, midPointY + perpY * wallLength / 2);
+    Cell end = ClampedCell(midPointX - perpX * wallLength / 2, midPointY - perpY * wallLength / 2);
+    entities.wallStart[w] = start;
+    entities.wallEnd[w] = end;
+    entities.wallTimer[w] = tuning.wallDuration;
+    entities.wallCountdown[w] = 3;
+   
+    // Rasterize the drawn line once; cells are counted so overlapping walls can expire independently
+    int startX = start % BOARD_COLS, startY = start / BOARD_COLS;
+    int spanX = end % BOARD_COLS - startX, spanY = end / BOARD_COLS - startY;
+    int steps = abs(spanX) > abs(spanY) ? abs(spanX) : abs(spanY);
+    entities.wallCellCount[w] = 0;
+    for (int i = 0; i <= steps && i < PHANTOM_WALL_MAX_CELLS; i++) {
+        float t = steps > 0 ? (float)i / steps : 0;
+        Cell cell = (int)roundf(startY + t * spanY) * BOARD_COLS + (int)roundf(startX + t * spanX);
+        entities.wallCells[w][entities.wallCellCount[w]++] = cell;
+        CoverWallCell(cell);
+    }
+   
+    // A wall may not cut the head off from a pickup it could reach; skip this one instead
+    if (ReachablePickups() < reachableBefore) {
+        RemovePhantomWall(w);
+        TraceSpan("GeneratePhantomWall", traceStart, "cells", 0);
+        return -1;
+    }
+    TraceSpan("GeneratePhantomWall", traceStart, "cells", entities.wallCellCount[w]);
+    return w;
+}
+
+// Each new food rolls for a golden fruit. Without a golden-life tuning a golden fruit lasts until the
+// next food appears, which replaces it or takes it away, as in the original game
+static inline void TopUpPickupsFor(int foodTarget, int golden, int minSteps) {
+    while (entities.foodCount < foodTarget) {
+        if (AddPickup(PICKUP_FOOD, 0, minSteps) < 0) break;
+        if (!golden) continue;
+        if (tuning.goldenLife <= 0) {
+            for (int i = entities.pickupCount - 1; i >= 0; i--) {
+                if (entities.pickupKind[i] == PICKUP_GOLDEN) RemovePickup(i);
+            }
+        }
+        if (SimRandomRange(&gameRng, 0, 4) == 0 && entities.goldenCount < tuning.goldenMax) {
+            AddPickup(PICKUP_GOLDEN, tuning.goldenLife > 0 ? tuning.goldenLife : INFINITY, minSteps);
+        }
+    }
+}
+
+void TopUpPickups() {
+    TopUpPickupsFor(tuning.foodTarget[currentMode], currentMode == CHALLENGE, currentMode == MAZE ? MAZE_FOOD_MIN_STEPS : 0);
+}
+
+void ResetEntities() {
+    memset(&entities, 0, sizeof(entities));
+    MarkBoardAll();
+    StampLevelWalls();
+    ResetReach();
+    if (currentMode > MAZE) return;
+    TopUpPickups();
+}
+
+void RebuildPickupGrid() {
+    memset(entities.pickupAt, 0, sizeof(entities.pickupAt));
+    entities.foodCount = entities.goldenCount = 0;
+    for (int i = 0; i < entities.pickupCount; i++) {
+        entities.pickupAt[entities.pickupCell[i]] = i + 1;
+        if (entities.pickupKind[i] == PICKUP_GOLDEN) entities.goldenCount++;
+        else entities.foodCount++;
+    }
+}
+
+// Rebuilds the per-cell lookups from the entity arrays, e.g. after loading a save
+void RebuildEntityGrid() {
+    MarkBoardAll();
+    RebuildPickupGrid();
+    memset(entities.wallsAt, 0, sizeof(entities.wallsAt));
+    for (int w = 0; w < entities.wallCount; w++) {
+        for (int i = 0; i < entities.wallCellCount[w]; i++) {
+            entities.wallsAt[entities.wallCells[w][i]]++;
+        }
+    }
+    StampLevelWalls();
+    ResetReach();
+}
+
+// Fixed unless a wall-ramp tuning brings walls faster as the snake grows
+float PhantomWallInterval() {
+    float fastest = tuning.wallInterval < PHANTOM_WALL_MIN_INTERVAL ? tuning.wallInterval : PHANTOM_WALL_MIN_INTERVAL;
+    float interval = tuning.wallInterval - snake.length * tuning.wallRamp;
+    return interval < fastest ? fastest : interval;
+}
+
+// ---------------------------------------------------------------------------
+// Mode kernels: each single-player mode gets its own frame step and snake
+// move, stamped out from the inline templates below with that mode's rules
+// as constants. ResetGame picks the set once, so the simulation never
+// branches on currentMode.
+// ---------------------------------------------------------------------------
+
+// The one place entities appear and disappear, plus the mode's clock
+static inline void StepModeKernel(float deltaTime, int timed, int hazards, int foodTarget, int minSteps) {
+    if (timed) {
+        timeAttackTimer -= deltaTime;
+        if (timeAttackTimer <= 0) {
+            running = 0;
+        }
+    }
+   
+    spawnedWall = -1;
+   
+    // Golden fruit and phantom walls only ever exist in the hazard mode
+    if (hazards) {
+        for (int i = entities.pickupCount - 1; i >= 0; i--) {
+            if (entities.pickupKind[i] != PICKUP_GOLDEN) continue;
+            entities.pickupLife[i] -= deltaTime;
+            if (entities.pickupLife[i] <= 0) RemovePickup(i);
+        }
+       
+        for (int w = entities.wallCount - 1; w >= 0; w--) {
+            entities.wallTimer[w] -= deltaTime;
+           
+            // Update countdown display (3, 2, 1)
+            int currentCountdown = (int)ceil(entities.wallTimer[w]);
+            if (currentCountdown >= 0 && currentCountdown <= 3) {
+                entities.wallCountdown[w] = currentCountdown;
+            }
+           
+            if (entities.wallTimer[w] <= 0) RemovePhantomWall(w);
+        }
+       
+        // The next wall's clock only runs while there is room for it, one wall at a time by default
+        if (entities.wallCount < tuning.wallMax) entities.wallSpawnTimer += deltaTime;
+        if (entities.wallSpawnTimer >= PhantomWallInterval()) {
+            spawnedWall = GeneratePhantomWall();
+            entities.wallSpawnTimer = 0;
+        }
+    }
+   
+    TopUpPickupsFor(foodTarget, hazards, minSteps);
+}
+
+// Returns the kind of pickup eaten this move, or -1
+static inline int MoveSnakeKernel(int wrap, int selfCollisionFrom, int foodSpeedStep) {
+    if (paused) return -1;
+    int x = SnakeCell(0) % BOARD_COLS + snake.dx;
+    int y = SnakeCell(0) / BOARD_COLS + snake.dy;
+   
+    if (wrap) {
+        if (x < 0) x = BOARD_COLS - 1;
+        if (x >= BOARD_COLS) x = 0;
+        if (y < 0) y = BOARD_ROWS - 1;
+        if (y >= BOARD_ROWS) y = 0;
+    } else {
+        // Wall collision; the head stays on the last cell
+        if (x < 0 || x >= BOARD_COLS || y < 0 || y >= BOARD_ROWS) {
+            running = 0;
+            return -1;
+        }
+    }
+    Cell newHead = y * BOARD_COLS + x;
+   
+    // Phantom wall collision
+    if (entities.wallsAt[newHead] > 0) {
+        running = 0;
+    }
+   
+    // Self collision against every segment, the tail included (Infinite mode lets short snakes pass through)
+    if (snake.length >= selfCollisionFrom && snake.bodyAt[newHead] > 0) {
+        running = 0;
+    }
+   
+    // Move snake: the head always advances, the tail stays put when growing
+    int oldLength = snake.length;
+    PushSnakeHead(newHead);
+   
+    // Eat whatever is on the new cell; replacements spawn in the next step
+    int slot = entities.pickupAt[newHead] - 1;
+    if (slot < 0) {
+        DropSnakeTail();
+        return -1;
+    }
+   
+    int kind = entities.pickupKind[slot];
+    int growth = 0;
+    if (kind == PICKUP_GOLDEN) {
+        if (oldLength < SNAKE_MAX_LENGTH - 3) growth = 3;
+        if (speed > 30) speed -= tuning.goldenSpeedStep;
+    } else {
+        if (oldLength < SNAKE_MAX_LENGTH) growth = 1;
+        if (speed > 40) speed -= foodSpeedStep;
+    }
+    RemovePickup(slot);
+   
+    // New segments grow out of the old tail
+    if (growth == 0) {
+        DropSnakeTail();
+    } else {
+        ExtendSnakeTail(growth - 1);
+    }
+    return kind;
+}
+
+void StepClassic(float deltaTime) { StepModeKernel(deltaTime, 0, 0, tuning.foodTarget[CLASSIC], 0); }
+void StepTimeAttack(float deltaTime) { StepModeKernel(deltaTime, 1, 0, tuning.foodTarget[TIME_ATTACK], 0); }
+void StepChallenge(float deltaTime) { StepModeKernel(deltaTime, 0, 1, tuning.foodTarget[CHALLENGE], 0); }
+void StepInfinite(float deltaTime) { StepModeKernel(deltaTime, 0, 0, tuning.foodTarget[INFINITE], 0); }
+void StepMaze(float deltaTime) { StepModeKernel(deltaTime, 0, 0, tuning.foodTarget[MAZE], MAZE_FOOD_MIN_STEPS); }
+
+int MoveSnakeClassic() { return MoveSnakeKernel(0, 0, tuning.foodSpeedStep[CLASSIC]); }
+int MoveSnakeTimeAttack() { return MoveSnakeKernel(0, 0, tuning.foodSpeedStep[TIME_ATTACK]); }
+int MoveSnakeChallenge() { return MoveSnakeKernel(0, 0, tuning.foodSpeedStep[CHALLENGE]); }
+int MoveSnakeInfinite() { return MoveSnakeKernel(1, 20, tuning.foodSpeedStep[INFINITE]); }
+int MoveSnakeMaze() { return MoveSnakeKernel(0, 0, tuning.foodSpeedStep[MAZE]); }
+
+const ModeKernel modeKernels[] = {
+    { StepClassic, MoveSnakeClassic, 1 },
+    { StepTimeAttack, MoveSnakeTimeAttack, 1 },
+    { StepChallenge, MoveSnakeChallenge, 1 },
+    { StepInfinite, MoveSnakeInfinite, 0 },
+    { StepMaze, MoveSnakeMaze, 1 }
+};
+
+void SelectModeKernel() {
+    if (currentMode <= MAZE) modeKernel = &modeKernels[currentMode];
+}
+
+#ifndef _WIN32
+
+// Heads for the first pickup, turning aside only for an edge, a wall or the body
+void SteerBenchSnake() {
+    static const int dirs[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    Cell head = SnakeCell(0);
+    Cell target = entities.pickupCount > 0 ? entities.pickupCell[0] : head;
+    int best = -1, bestDistance = BOARD_CELLS;
+    for (int d = 0; d < 4; d++) {
+        if (dirs[d][0] == -snake.dx && dirs[d][1] == -snake.dy) continue;
+        int x = (int)(head % BOARD_COLS) + dirs[d][0];
+        int y = (int)(head / BOARD_COLS) + dirs[d][1];
+        if (x < 0 || x >= BOARD_COLS || y < 0 || y >= BOARD_ROWS) continue;
+        Cell next = y * BOARD_COLS + x;
+        if (snake.bodyAt[next] || entities.wallsAt[next]) continue;
+        int distance = abs((int)(target % BOARD_COLS) - x) + abs((int)(target / BOARD_COLS) - y);
+        if (distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+        }
+    }
+    if (best >= 0) {
+        snake.dx = dirs[best][0];
+        snake.dy = dirs[best][1];
+    }
+}
+
+// --bench [ticks]: seeded headless games of each mode through its kernel, timing one step plus one
+// move per tick; setting up each game is left out
+int RunBenchmark(long ticks) {
+    static const char* modeNames[] = { "Classic", "Time Attack", "Challenge", "Infinite", "Maze" };
+    if (ticks < 1) ticks = 1;
+    int lastMode = LoadLevel(levelPath) ? MAZE : INFINITE;
+    printf("mode          ns/tick       ticks   games\n");
+    for (int mode = CLASSIC; mode <= lastMode; mode++) {
+        currentMode = (GameMode)mode;
+        gameRng = SeedRandom(1);
+        tuning = playTuning;
+        SelectModeKernel();
+        long done = 0;
+        int games = 0;
+        double micros = 0;
+        while (done < ticks) {
+            speed = tuning.baseSpeed;
+            timeAttackTimer = tuning.timeAttackDuration;
+            running = 1;
+            paused = 0;
+            InitSnake();
+            ResetEntities();
+            games++;
+           
+            double start = TraceNow();
+            for (int move = 0; running && move < BENCH_GAME_MOVES && done < ticks; move++) {
+                SteerBenchSnake();
+                modeKernel->step(speed / 1000.0f);
+                modeKernel->moveSnake();
+                if (!modeKernel->endsOnDeath) running = 1;
+                done++;
+            }
+            micros += TraceNow() - start;
+        }
+        printf("%-12s %8.1f %11ld %7d\n", modeNames[mode], micros * 1000.0 / done, done, games);
+    }
+    return 0;
+}
+
+#else
+
+int RunBenchmark(long ticks) {
+    fprintf(stderr, "The benchmark needs a monotonic clock and is not available on this platform\n");
+    return 1;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Particle effects: one fixed pool shared by every effect. Fields live in
+// separate arrays so the integration loops vectorize, and all live particles
+// go to the GPU as plain quads in a few large rlgl batches.
+// ---------------------------------------------------------------------------
+
+Color SnakeSegmentColor(int i) {
+    // Gradient from head to tail in the mode's accent color
+    float colorFactor = (float)i / snake.length;
+    Color c = currentMode == CLASSIC ? accentColor1 : currentMode == TIME_ATTACK ? accentColor2 : accentColor3;
+    return (Color){
+        (unsigned char)(c.r * (1.0f - colorFactor * 0.5f)),
+        (unsigned char)(c.g * (1.0f - colorFactor * 0.3f)),
+        (unsigned char)(c.b * (1.0f - colorFactor * 0.1f)),
+        255
+    };
+}
+
+float ParticleRandom() {
+    return (SimRandom(&particleRng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Sprays count particles from a spread x spread square; silently drops what does not fit
+void EmitParticles(float x, float y, float spread, int count, Color color, float speed, float life, float size) {
+    if (count > MAX_PARTICLES - particles.count) count = MAX_PARTICLES - particles.count;
+    for (int n = 0; n < count; n++) {
+        int i = particles.count++;
+        float angle = ParticleRandom() * 2.0f * PI;
+        float velocity = speed * (0.3f + 0.7f * ParticleRandom());
+        particles.x[i] = x + (ParticleRandom() - 0.5f) * spread;
+        particles.y[i] = y + (ParticleRandom() - 0.5f) * spread;
+        particles.vx[i] = cosf(angle) * velocity;
+        particles.vy[i] = sinf(angle) * velocity;
+        particles.life[i] = life * (0.5f + 0.5f * ParticleRandom());
+        particles.fade[i] = 1.0f / particles.life[i];
+        particles.size[i] = size * (0.5f + 0.5f * ParticleRandom());
+        particles.color[i] = color;
+    }
+}
+
+void ClearParticles() {
+    particles.count = 0;
+}
+
+void EmitPickupBurst(Cell cell, int kind) {
+    float x = CellX(cell) + GRID_SIZE / 2;
+    float y = CellY(cell) + GRID_SIZE / 2;
+    if (kind == PICKUP_GOLDEN) {
+        EmitParticles(x, y, GRID_SIZE, 300, (Color){ 255, 200, 40, 255 }, 220, 0.9f, 4);
+    } else {
+        EmitParticles(x, y, GRID_SIZE / 2, 80, (Color){ 220, 30, 30, 255 }, 140, 0.6f, 3);
+    }
+}
+
+// The whole body breaks up into its own colors
+void EmitSnakeDissolve() {
+    for (int i = 0; i < snake.length; i++) {
+        Cell cell = SnakeCell(i);
+        EmitParticles(CellX(cell) + GRID_SIZE / 2, CellY(cell) + GRID_SIZE / 2,
+                      GRID_SIZE, 40, SnakeSegmentColor(i), 60, 1.6f, 3);
+    }
+}
+
+void EmitWallSparks(float deltaTime) {
+    int sparks = (int)(deltaTime * 90.0f) + 1;  // Per wall, roughly 90 a second
+    for (int w = 0; w < entities.wallCount; w++) {
+        for (int n = 0; n < sparks; n++) {
+            Cell cell = entities.wallCells[w][SimRandom(&particleRng) % entities.wallCellCount[w]];
+            EmitParticles(CellX(cell) + GRID_SIZE / 2, CellY(cell) + GRID_SIZE / 2, GRID_SIZE,
+                          1, (Color){ 255, 150 + SimRandom(&particleRng) % 80, 90, 255 }, 90, 0.4f, 2);
+        }
+    }
+}
+
+void UpdateParticles(float deltaTime) {
+    // Whole blocks of 8 so even -O2 vectorizes without a scalar tail; the pool is a multiple of 8
+    int count = (particles.count + 7) & ~7;
+    float drag = 1.0f - PARTICLE_DRAG * deltaTime;
+    float fall = PARTICLE_GRAVITY * deltaTime;
+    float* restrict x = particles.x;
+    float* restrict y = particles.y;
+    float* restrict vx = particles.vx;
+    float* restrict vy = particles.vy;
+    float* restrict life = particles.life;
+   
+    for (int block = 0; block < count; block += 8) {
+        for (int i = block; i < block + 8; i++) {
+            x[i] += vx[i] * deltaTime;
+            y[i] += vy[i] * deltaTime;
+            vx[i] *= drag;
+            vy[i] = vy[i] * drag + fall;
+            life[i] -= deltaTime;
+        }
+    }
+    count = particles.count;
+   
+    // Compact the survivors to the front, keeping emission order
+    int live = 0;
+    for (int i = 0; i < count; i++) {
+        if (life[i] <= 0) continue;
+        if (live != i) {
+            x[live] = x[i];
+            y[live] = y[i];
+            vx[live] = vx[i];
+            vy[live] = vy[i];
+            life[live] = life[i];
+            particles.fade[live] = particles.fade[i];
+            particles.size[live] = particles.size[i];
+            particles.color[live] = particles.color[i];
+        }
+        live++;
+    }
+    particles.count = live;
+}
+
+void DrawParticles() {
+    for (int start = 0; start < particles.count; start += PARTICLE_BATCH) {
+        int end = start + PARTICLE_BATCH < particles.count ? start + PARTICLE_BATCH : particles.count;
+       
+        // Flush up front, never in the middle of a quad run
+        rlCheckRenderBatchLimit((end - start) * 4);
+        rlBegin(RL_QUADS);
+        for (int i = start; i < end; i++) {
+            float alpha = particles.life[i] * particles.fade[i];
+            float half = particles.size[i] * 0.5f;
+            Color c = particles.color[i];
+            rlColor4ub(c.r, c.g, c.b, (unsigned char)(c.a * alpha));
+            rlVertex2f(particles.x[i] - half, particles.y[i] - half);
+            rlVertex2f(particles.x[i] - half, particles.y[i] + half);
+            rlVertex2f(particles.x[i] + half, particles.y[i] + half);
+            rlVertex2f(particles.x[i] + half, particles.y[i] - half);
+        }
+        rlEnd();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Audio: every sound is synthesized into PCM once at startup and mixed on
+// the audio device thread through a raylib stream callback. The game thread
+// only posts commands into a single-producer/single-consumer ring, so
+// gameplay code never waits on the mixer. Commands may carry an absolute
+// start frame on the mixer's clock, which keeps the phantom wall countdown
+// beeps exactly one second apart and lined up with the on-screen digits.
+// ---------------------------------------------------------------------------
+
+// Renders one of the built-in sounds into a freshly allocated mono buffer
+PcmBuffer SynthesizeSound(int sound) {
+    static const float musicRoots[4] = { 110.0f, 87.31f, 130.81f, 98.0f };  // A2 F2 C3 G2
+    static const float arpeggio[4] = { 1.0f, 1.5f, 2.0f, 2.5198f };  // Root, fifth, octave, tenth
+    float seconds[SFX_COUNT] = { 0.09f, 0.3f, 0.1f, 0.16f, 0.7f, 8.0f };
+   
+    PcmBuffer pcm;
+    pcm.length = (int)(seconds[sound] * AUDIO_SAMPLE_RATE);
+    pcm.samples = malloc(pcm.length * sizeof(short));
+    if (pcm.samples == NULL) {
+        pcm.length = 0;
+        return pcm;
+    }
+   
+    unsigned int noise = 0x1234567;
+    float phase = 0;
+    for (int i = 0; i < pcm.length; i++) {
+        float t = (float)i / AUDIO_SAMPLE_RATE;
+        float progress = (float)i / pcm.length;
+        float frequency = 440.0f, volume = 0, value = 0;
+       
+        switch (sound) {
+            case SFX_EAT:  // Quick upward chirp
+                frequency = 880.0f + 660.0f * progress;
+                volume = 0.5f * (1.0f - progress);
+                break;
+            case SFX_GOLDEN:  // C6 E6 G6 arpeggio
+                frequency = progress < 0.33f ? 1046.5f : progress < 0.66f ? 1318.5f : 1568.0f;
+                volume = 0.45f * (1.0f - progress * 0.7f);
+                break;
+            case SFX_BEEP:
+                frequency = 1000.0f;
+                volume = progress < 0.9f ? 0.4f : 0.4f * (1.0f - progress) * 10.0f;
+                break;
+            case SFX_BEEP_HIGH:
+                frequency = 1500.0f;
+                volume = progress < 0.9f ? 0.45f : 0.45f * (1.0f - progress) * 10.0f;
+                break;
+            case SFX_DEATH:  // Falling tone with a burst of noise
+                frequency = 420.0f * (1.0f - 0.75f * progress);
+                volume = 0.5f * (1.0f - progress);
+                noise = SimRandom(&noise);
+                value = ((int)(noise & 0xFFFF) - 32768) / 32768.0f * 0.35f * (1.0f - progress) * (1.0f - progress);
+                break;
+            case SFX_MUSIC: {  // Soft bass and arpeggio, one chord every two seconds
+                int bar = (int)(t / 2.0f) & 3;
+                int step = (int)(t * 4.0f);
+                float stepTime = t * 4.0f - step;
+                float root = musicRoots[bar];
+                float arp = root * 4.0f * arpeggio[step & 3];
+                float bass = sinf(2.0f * PI * root * t) * 0.5f;
+                float lead = (fmodf(arp * t, 1.0f) < 0.5f ? 0.2f : -0.2f) * (1.0f - stepTime);
+                value = (bass + lead) * 0.35f;
+                break;
+            }
+        }
+        if (sound != SFX_MUSIC) {
+            phase += frequency / AUDIO_SAMPLE_RATE;
+            value += (fmodf(phase, 1.0f) < 0.5f ? 1.0f : -1.0f) * volume * 0.5f + sinf(2.0f * PI * phase) * volume * 0.5f;
+        }
+        pcm.samples[i] = (short)(fmaxf(-1.0f, fminf(1.0f, value)) * 32767.0f);
+    }
+    return pcm;
+}
+
+// Game thread: never blocks, drops the command if the mixer has fallen a full ring behind
+void PostAudio(int type, int sound, int tag, float volume, unsigned long long startFrame) {
+    if (!audioReady) return;
+    unsigned int head = atomic_load_explicit(&audioQueueHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&audioQueueTail, memory_order_acquire);
+    if (head - tail >= AUDIO_QUEUE_SIZE) return;
+   
+    AudioCommand* command = &audioQueue[head & (AUDIO_QUEUE_SIZE - 1)];
+    command->type = type;
+    command->sound = sound;
+    command->tag = tag;
+    command->volume = volume;
+    command->startFrame = startFrame;
+    atomic_store_explicit(&audioQueueHead, head + 1, memory_order_release);
+}
+
+void PostSound(int sound) {
+    PostAudio(AUDIO_PLAY, sound, AUDIO_TAG_NONE, 1.0f, 0);
+}
+
+// Earliest mixer frame a command posted now can still hit exactly
+unsigned long long AudioNow() {
+    return atomic_load_explicit(&audioClock, memory_order_acquire) + AUDIO_BUFFER_FRAMES;
+}
+
+// Audio thread: applies queued commands, then mixes every voice into the stream buffer
+void MixAudio(void* buffer, unsigned int frames) {
+    if (tracing && traceLocal == NULL) TraceThreadName("audio");
+    double traceStart = TraceBegin();
+    short* out = buffer;
+    unsigned long long clock = atomic_load_explicit(&audioClock, memory_order_relaxed);
+   
+    unsigned int tail = atomic_load_explicit(&audioQueueTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&audioQueueHead, memory_order_acquire);
+    for (; tail != head; tail++) {
+        AudioCommand command = audioQueue[tail & (AUDIO_QUEUE_SIZE - 1)];
+        if (command.type == AUDIO_STOP_TAG) {
+            for (int v = 0; v < AUDIO_MAX_VOICES; v++) {
+                if (audioVoices[v].active && audioVoices[v].tag == command.tag) audioVoices[v].active = 0;
+            }
+            continue;
+        }
+        for (int v = 0; v < AUDIO_MAX_VOICES; v++) {
+            if (audioVoices[v].active) continue;
+            audioVoices[v].active = 1;
+            audioVoices[v].sound = command.sound;
+            audioVoices[v].tag = command.tag;
+            audioVoices[v].volume = command.volume;
+            audioVoices[v].startFrame = command.startFrame > clock ? command.startFrame : clock;
+            break;
+        }
+    }
+    atomic_store_explicit(&audioQueueTail, tail, memory_order_release);
+   
+    for (unsigned int done = 0; done < frames; ) {
+        unsigned int count = frames - done < AUDIO_MIX_CHUNK ? frames - done : AUDIO_MIX_CHUNK;
+        unsigned long long chunkStart = clock + done;
+        memset(audioMix, 0, count * sizeof(float));
+       
+        for (int v = 0; v < AUDIO_MAX_VOICES; v++) {
+            AudioVoice* voice = &audioVoices[v];
+            if (!voice->active || voice->startFrame >= chunkStart + count) continue;
+           
+            // Scheduled voices start on their exact frame inside the chunk
+            const PcmBuffer* pcm = &audioSounds[voice->sound];
+            unsigned int first = voice->startFrame > chunkStart ? (unsigned int)(voice->startFrame - chunkStart) : 0;
+            for (unsigned int i = first; i < count; i++) {
+                unsigned long long index = chunkStart + i - voice->startFrame;
+                if (voice->tag == AUDIO_TAG_MUSIC) {
+                    index %= pcm->length;
+                } else if (index >= (unsigned long long)pcm->length) {
+                    voice->active = 0;
+                    break;
+                }
+                audioMix[i] += pcm->samples[index] * voice->volume;
+            }
+        }
+       
+        for (unsigned int i = 0; i < count; i++) {
+            float sample = audioMix[i];
+            out[done + i] = (short)(sample > 32767.0f ? 32767.0f : sample < -32768.0f ? -32768.0f : sample);
+        }
+        done += count;
+    }
+   
+    atomic_store_explicit(&audioClock, clock + frames, memory_order_release);
+    TraceSpan("MixAudio", traceStart, "frames", frames);
+}
+
+void InitGameAudio() {
+    InitAudioDevice();
+    if (!IsAudioDeviceReady()) return;
+   
+    for (int s = 0; s < SFX_COUNT; s++) {
+        audioSounds[s] = SynthesizeSound(s);
+        if (audioSounds[s].length == 0) return;
+    }
+   
+    // Small stream buffers keep trigger-to-output latency down
+    SetAudioStreamBufferSizeDefault(AUDIO_BUFFER_FRAMES);
+    audioStream = LoadAudioStream(AUDIO_SAMPLE_RATE, 16, 1);
+    SetAudioStreamCallback(audioStream, MixAudio);
+    audioReady = 1;
+    PlayAudioStream(audioStream);
+}
+
+void CloseGameAudio() {
+    if (IsAudioDeviceReady()) {
+        if (audioReady) {
+            StopAudioStream(audioStream);
+            UnloadAudioStream(audioStream);
+        }
+        CloseAudioDevice();
+    }
+    audioReady = 0;
+    for (int s = 0; s < SFX_COUNT; s++) {
+        free(audioSounds[s].samples);
+        audioSounds[s].samples = NULL;
+    }
+}
+
+// Queues the 3-2-1 beeps still ahead of a wall, each on the frame its digit appears
+void ScheduleWallBeeps(int w, unsigned long long now) {
+    for (int digit = 3; digit >= 1; digit--) {
+        float delay = entities.wallTimer[w] - digit;
+        if (delay < -0.05f) continue;  // Already shown
+        if (delay < 0) delay = 0;
+        PostAudio(AUDIO_PLAY, digit == 1 ? SFX_BEEP_HIGH : SFX_BEEP, AUDIO_TAG_WALL, 0.8f,
+                  now + (unsigned long long)(delay * AUDIO_SAMPLE_RATE));
+    }
+}
+
+// Called once per frame: music and wall beeps only run while a game is live. A rewind winds the
+// wall timers back (and can take walls away), so their beeps stop with it and are queued again
+// from the restored timers once play resumes.
+void UpdateGameAudio() {
+    int live = currentState == GAME && !paused;
+    int wallsLive = live && !rewinding && currentMode <= MAZE;
+    if (live != audioLive) {
+        audioLive = live;
+        PostAudio(AUDIO_STOP_TAG, 0, AUDIO_TAG_MUSIC, 0, 0);
+        if (live) PostAudio(AUDIO_PLAY, SFX_MUSIC, AUDIO_TAG_MUSIC, 0.6f, 0);
+    }
+    if (wallsLive == audioWallsLive) return;
+    audioWallsLive = wallsLive;
+   
+    PostAudio(AUDIO_STOP_TAG, 0, AUDIO_TAG_WALL, 0, 0);
+    if (!wallsLive) return;
+   
+    unsigned long long now = AudioNow();
+    for (int w = 0; w < entities.wallCount; w++) {
+        ScheduleWallBeeps(w, now);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Save / resume: the running single-player game is written on pause and on
+// quit, and restored at startup straight into a paused game.
+// ---------------------------------------------------------------------------
+
+unsigned int SaveChecksum(const SaveFile* save) {
+    const unsigned char* bytes = (const unsigned char*)save + offsetof(SaveFile, mode);
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(SaveFile) - offsetof(SaveFile, mode); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void FillSaveFile(SaveFile* save) {
+    memset(save, 0, sizeof(*save));  // Padding too, so the checksum is stable
+    memcpy(save->magic, "SNKS", 4);
+    save->version = SAVE_VERSION;
+    save->size = sizeof(SaveFile);
+    save->mode = currentMode;
+    save->snakeLength = snake.length;
+    save->snakeDx = snake.dx;
+    save->snakeDy = snake.dy;
+    for (int i = 0; i < snake.length; i++) {
+        save->snakeBody[i] = SnakeCell(i);
+    }
+    save->entities = entities;
+    save->speed = speed;
+    save->timeAttackTimer = timeAttackTimer;
+    save->sinceLastMove = gameClock - lastUpdateTime;
+    save->rng = gameRng;
+    save->level = currentMode == MAZE && level != NULL ? level->checksum : 0;
+    save->tuning = tuning;
+    save->checksum = SaveChecksum(save);
+}
+
+void SaveGameSnapshot() {
+    if (currentMode == ARENA || currentMode == VERSUS || !running || replayPlayback) return;
+   
+    SaveFile save;
+    FillSaveFile(&save);
+   
+    // Write beside the old save and swap it in, so a crash never leaves half a file
+    FILE* file = fopen(SAVE_TEMP_NAME, "wb");
+    if (file == NULL) return;
+    int ok = fwrite(&save, sizeof(save), 1, file) == 1 && fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    fclose(file);
+    if (!ok) {
+        remove(SAVE_TEMP_NAME);
+        return;
+    }
+#ifdef _WIN32
+    remove(SAVE_FILE_NAME);  // rename() does not replace on Windows
+#endif
+    rename(SAVE_TEMP_NAME, SAVE_FILE_NAME);
+}
+
+void DeleteGameSnapshot() {
+    if (replayPlayback) return;
+    remove(SAVE_FILE_NAME);
+}
+
+int EntitiesInBounds(const Entities* e) {
+    if (e->pickupCount < 0 || e->pickupCount > MAX_PICKUPS) return 0;
+    if (e->wallCount < 0 || e->wallCount > MAX_PHANTOM_WALLS) return 0;
+    for (int i = 0; i < e->pickupCount; i++) {
+        if (e->pickupCell[i] >= BOARD_CELLS || e->pickupKind[i] > PICKUP_GOLDEN) return 0;
+    }
+    for (int w = 0; w < e->wallCount; w++) {
+        if (e->wallStart[w] >= BOARD_CELLS || e->wallEnd[w] >= BOARD_CELLS) return 0;
+        if (e->wallCellCount[w] > PHANTOM_WALL_MAX_CELLS) return 0;
+        for (int i = 0; i < e->wallCellCount[w]; i++) {
+            if (e->wallCells[w][i] >= BOARD_CELLS) return 0;
+        }
+    }
+    return 1;
+}
+
+int RestoreGameSnapshot(const SaveFile* save) {
+    if (memcmp(save->magic, "SNKS", 4) != 0 || save->version != SAVE_VERSION ||
+        save->size != sizeof(SaveFile) || save->checksum != SaveChecksum(save) ||
+        save->mode < CLASSIC || save->mode > MAZE ||
+        save->snakeLength < 1 || save->snakeLength > SNAKE_MAX_LENGTH) {
+        return 0;
+    }
+    // Cell indices feed array lookups directly, so never trust one from disk
+    for (int i = 0; i < save->snakeLength; i++) {
+        if (save->snakeBody[i] >= BOARD_CELLS) return 0;
+    }
+    if (!EntitiesInBounds(&save->entities) || !TuningInBounds(&save->tuning)) return 0;
+    if (save->mode == MAZE && (!LoadLevel(levelPath) || level->checksum != save->level)) return 0;
+   
+    selectedMode = currentMode = (GameMode)save->mode;
+    selectedOption = save->mode;
+    ClearSnakeBody();
+    for (int i = save->snakeLength - 1; i >= 0; i--) {
+        PushSnakeHead(save->snakeBody[i]);
+    }
+    snake.dx = save->snakeDx;
+    snake.dy = save->snakeDy;
+    entities = save->entities;
+    RebuildEntityGrid();
+    SelectModeKernel();
+    ClearRewind();
+    tuning = save->tuning;
+    speed = save->speed;
+    timeAttackTimer = save->timeAttackTimer;
+    gameClock = 0;
+    lastUpdateTime = -save->sinceLastMove;
+    gameRng = save->rng;
+    running = 1;
+    paused = 1;
+    canvasValid = 0;
+    return 1;
+}
+
+// Maps the snapshot instead of parsing it; returns 1 when a game was resumed
+int LoadGameSnapshot() {
+    double start = GetTime();
+    int restored = 0;
+   
+#ifndef _WIN32
+    int fd = open(SAVE_FILE_NAME, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size == (off_t)sizeof(SaveFile)) {
+        const SaveFile* save = mmap(NULL, sizeof(SaveFile), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (save != MAP_FAILED) {
+            restored = RestoreGameSnapshot(save);
+            munmap((void*)save, sizeof(SaveFile));
+        }
+    }
+    close(fd);
+#else
+    SaveFile save;
+    FILE* file = fopen(SAVE_FILE_NAME, "rb");
+    if (file == NULL) return 0;
+    if (fread(&save, sizeof(save), 1, file) == 1) restored = RestoreGameSnapshot(&save);
+    fclose(file);
+#endif
+   
+    if (restored) {
+        TraceLog(LOG_INFO, "Resumed saved game in %.3f ms", (GetTime() - start) * 1000.0);
+    }
+    return restored;
+}
+
+// ---------------------------------------------------------------------------
+// Leaderboard: every finished single-player run is appended to its mode's
+// score log, which is never rewritten. Beside it sits a small index holding
+// the best runs and, for every possible score, how many runs reached it, so
+// a run's rank is one lookup however long the history grows. The index is
+// replaced atomically after each run; if a crash lands between the append
+// and the index write, the runs the index is missing are folded in on load.
+// ---------------------------------------------------------------------------
+
+const char* leaderboardNames[] = { "classic", "timeattack", "challenge", "infinite", "maze" };
+
+void LeaderboardPath(char* path, size_t size, int mode, const char* extension) {
+    snprintf(path, size, "scores_%s.%s", leaderboardNames[mode], extension);
+}
+
+unsigned int ScoreRecordCheck(const ScoreRecord* record) {
+    const unsigned char* bytes = (const unsigned char*)record;
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(ScoreRecord, check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+unsigned int ScoreIndexChecksum(const ScoreIndex* index) {
+    const unsigned char* bytes = (const unsigned char*)index;
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(ScoreIndex, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int ClampScore(int score) {
+    return score < 0 ? 0 : score > LEADERBOARD_MAX_SCORE ? LEADERBOARD_MAX_SCORE : score;
+}
+
+// Runs that scored more, plus one; runs on the same score share a rank
+int LeaderboardRank(const ScoreIndex* index, int score) {
+    return index->atOrAbove[ClampScore(score) + 1] + 1;
+}
+
+void FoldScore(ScoreIndex* index, const ScoreRecord* record) {
+    int score = ClampScore(record->score);
+    for (int s = 0; s <= score; s++) {
+        index->atOrAbove[s]++;
+    }
+    index->records++;
+   
+    // Behind every equal score, so the earlier run keeps its place
+    int at = index->topCount;
+    while (at > 0 && index->top[at - 1].score < record->score) at--;
+    if (at >= LEADERBOARD_TOP) return;
+    int last = index->topCount < LEADERBOARD_TOP ? index->topCount : LEADERBOARD_TOP - 1;
+    memmove(&index->top[at + 1], &index->top[at], (last - at) * sizeof(ScoreRecord));
+    index->top[at] = *record;
+    if (index->topCount < LEADERBOARD_TOP) index->topCount++;
+}
+
+void WriteLeaderboardIndex(int mode) {
+    ScoreIndex* index = &leaderboards[mode];
+    index->checksum = ScoreIndexChecksum(index);
+    char path[64], temp[64];
+    LeaderboardPath(path, sizeof(path), mode, "idx");
+    LeaderboardPath(temp, sizeof(temp), mode, "idx.tmp");
+   
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL) return;
+    int ok = fwrite(index, sizeof(*index), 1, file) == 1 && fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    fclose(file);
+    if (!ok) {
+        remove(temp);
+        return;
+    }
+#ifdef _WIN32
+    remove(path);
+#endif
+    rename(temp, path);
+}
+
+// Reads the mode's index once and brings it up to date with the log; a
+// missing or damaged index is rebuilt from the whole log
+ScoreIndex* LoadLeaderboard(int mode) {
+    ScoreIndex* index = &leaderboards[mode];
+    if (leaderboardLoaded[mode]) return index;
+    double start = MonotonicSeconds();
+    char path[64];
+   
+    LeaderboardPath(path, sizeof(path), mode, "idx");
+    FILE* file = fopen(path, "rb");
+    int ok = file != NULL && fread(index, sizeof(*index), 1, file) == 1;
+    if (file != NULL) fclose(file);
+    ok = ok && memcmp(index->magic, "SNKB", 4) == 0 && index->version == LEADERBOARD_VERSION &&
+         index->topCount >= 0 && index->topCount <= LEADERBOARD_TOP && index->checksum == ScoreIndexChecksum(index);
+   
+    LeaderboardPath(path, sizeof(path), mode, "log");
+    file = fopen(path, "rb");
+    long logRecords = 0;
+    if (file != NULL && fseek(file, 0, SEEK_END) == 0) {
+        logRecords = ftell(file) / (long)sizeof(ScoreRecord);
+    }
+    if (!ok || index->records > (unsigned long)logRecords) {
+        memset(index, 0, sizeof(*index));  // The log is the record; the index is only a cache of it
+        memcpy(index->magic, "SNKB", 4);
+        index->version = LEADERBOARD_VERSION;
+    }
+   
+    // Fold in whatever the index is missing, stopping at a torn append
+    unsigned int indexed = index->records;
+    if (file != NULL) {
+        ScoreRecord record;
+        if (fseek(file, (long)index->records * (long)sizeof(ScoreRecord), SEEK_SET) == 0) {
+            while (fread(&record, sizeof(record), 1, file) == 1 && record.check == ScoreRecordCheck(&record)) {
+                FoldScore(index, &record);
+            }
+        }
+        fclose(file);
+    }
+#ifndef _WIN32
+    // Cut a torn tail off, or the next run would be appended out of step
+    struct stat info;
+    off_t valid = (off_t)index->records * (off_t)sizeof(ScoreRecord);
+    if (stat(path, &info) == 0 && info.st_size > valid && truncate(path, valid) != 0) {
+        TraceLog(LOG_WARNING, "Could not trim %s", path);
+    }
+#endif
+    if (index->records != indexed) WriteLeaderboardIndex(mode);
+    leaderboardLoaded[mode] = 1;
+    TraceLog(LOG_INFO, "Loaded %s leaderboard (%u runs, %u from the log) in %.3f ms", leaderboardNames[mode],
+             index->records, index->records - indexed, (MonotonicSeconds() - start) * 1000.0);
+    return index;
+}
+
+// Appends the run that just ended to its mode's log and notes its rank for the game over screen
+void RecordScore() {
+    lastRank = 0;
+    if (replayPlayback || currentMode > MAZE) return;
+    ScoreIndex* index = LoadLeaderboard(currentMode);
+   
+    ScoreRecord record = { snake.length - 2, (unsigned int)time(NULL), (float)gameClock, 0 };
+    record.check = ScoreRecordCheck(&record);
+    char path[64];
+    LeaderboardPath(path, sizeof(path), currentMode, "log");
+    FILE* file = fopen(path, "ab");
+    if (file == NULL) return;
+    int ok = fwrite(&record, sizeof(record), 1, file) == 1 && fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    fclose(file);
+    if (!ok) {
+        leaderboardLoaded[currentMode] = 0;  // Reloading trims whatever part of the record landed
+        return;
+    }
+   
+    FoldScore(index, &record);
+    WriteLeaderboardIndex(currentMode);
+    lastRank = LeaderboardRank(index, record.score);
+}
+
+// --leaderboard: the best runs and run count of every mode
+int PrintLeaderboards() {
+    SetTraceLogLevel(LOG_WARNING);
+    for (int mode = 0; mode <= MAZE; mode++) {
+        ScoreIndex* index = LoadLeaderboard(mode);
+        printf("%s: %u runs\n", leaderboardNames[mode], index->records);
+        for (int i = 0; i < index->topCount; i++) {
+            char when[32];
+            time_t t = (time_t)index->top[i].when;
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&t));
+            printf("  %2d. %5d  %7.1fs  %s\n", i + 1, index->top[i].score, index->top[i].seconds, when);
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Replay recording: the simulation only reads frame deltas, the direction and
+// the pause flag, so those eight bytes per frame plus the starting state are
+// enough to re-simulate a game exactly.
+// ---------------------------------------------------------------------------
+
+void StopReplayRecording() {
+    if (replayFile == NULL) return;
+    fclose(replayFile);
+    replayFile = NULL;
+}
+
+void StartReplayRecording() {
+    StopReplayRecording();
+    if (replayDir == NULL || replayPlayback || currentMode == ARENA || currentMode == VERSUS) return;
+   
+    // Rebase the clock so the game and its re-simulation see identical doubles from here on
+    lastUpdateTime -= gameClock;
+    gameClock = 0;
+   
+    // A fixed set of names, reusing the first free one or else the oldest, so kiosks never fill the disk
+    char fileName[512];
+    int slot = 0;
+    long oldest = LONG_MAX;
+    for (int i = 0; i < REPLAY_KEEP; i++) {
+        snprintf(fileName, sizeof(fileName), "%s/replay_%02d.rep", replayDir, i);
+        if (!FileExists(fileName)) {
+            slot = i;
+            break;
+        }
+        long modified = GetFileModTime(fileName);
+        if (modified < oldest) {
+            oldest = modified;
+            slot = i;
+        }
+    }
+    snprintf(fileName, sizeof(fileName), "%s/replay_%02d.rep", replayDir, slot);
+    replayFile = fopen(fileName, "wb");
+    if (replayFile == NULL) {
+        TraceLog(LOG_WARNING, "Could not record replay to %s", fileName);
+        return;
+    }
+   
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKR", 4);
+    header.version = REPLAY_VERSION;
+    FillSaveFile(&header.start);
+    fwrite(&header, sizeof(header), 1, replayFile);
+}
+
+void RecordReplayFrame(float deltaTime) {
+    if (replayFile == NULL) return;
+    ReplayFrame frame = { deltaTime, snake.dx, snake.dy, (unsigned char)paused, (unsigned char)rewinding };
+    fwrite(&frame, sizeof(frame), 1, replayFile);
+}
+
+double AnimationTime() {
+    return offlineTarget.id != 0 ? offlineClock : GetTime();
+}
+
+// ---------------------------------------------------------------------------
+// Rewind (hold R or Backspace). Each snake move first appends a record of
+// what it is about to change: the head it pushes and the tail it drops,
+// the scalars it touches and the few live pickups and walls. Undoing a move
+// therefore never copies the body, and a record costs the same at any snake
+// length. The oldest records fall off as the ring fills.
+// ---------------------------------------------------------------------------
+
+void RewindCopy(unsigned int at, const void* data, int size) {
+    unsigned int offset = at & (REWIND_BYTES - 1);
+    int first = size < (int)(REWIND_BYTES - offset) ? size : (int)(REWIND_BYTES - offset);
+    memcpy(rewindBytes + offset, data, first);
+    memcpy(rewindBytes, (const unsigned char*)data + first, size - first);
+}
+
+void RewindFetch(unsigned int at, void* data, int size) {
+    unsigned int offset = at & (REWIND_BYTES - 1);
+    int first = size < (int)(REWIND_BYTES - offset) ? size : (int)(REWIND_BYTES - offset);
+    memcpy(data, rewindBytes + offset, first);
+    memcpy((unsigned char*)data + first, rewindBytes, size - first);
+}
+
+void ClearRewind() {
+    rewindFirst = rewindLast = 0;
+    rewindEnd = 0;
+    rewindMilliseconds = 0;
+    rewindBudget = 0;
+    rewinding = 0;
+}
+
+void DropOldestRewindTick() {
+    RewindTick oldest;
+    RewindFetch(rewindStart[rewindFirst % REWIND_TICKS], &oldest, sizeof(oldest));
+    rewindMilliseconds -= oldest.speed;
+    rewindFirst++;
+}
+
+int RewindBytesUsed() {
+    return rewindLast == rewindFirst ? 0 : (int)(rewindEnd - rewindStart[rewindFirst % REWIND_TICKS]);
+}
+
+// Makes one snake move, recording beforehand everything it is about to change
+int MoveSnakeRewindable() {
+    while (rewindLast - rewindFirst >= REWIND_TICKS ||
+           (rewindLast != rewindFirst && RewindBytesUsed() + (int)REWIND_MAX_RECORD > REWIND_BYTES)) {
+        DropOldestRewindTick();
+    }
+   
+    RewindTick tick;
+    memset(&tick, 0, sizeof(tick));
+    tick.tail = SnakeCell(snake.length - 1);
+    tick.dx = snake.dx;
+    tick.dy = snake.dy;
+    tick.pickupCount = entities.pickupCount;
+    tick.wallCount = entities.wallCount;
+    tick.speed = speed;
+    tick.timeAttackTimer = timeAttackTimer;
+    tick.wallSpawnTimer = entities.wallSpawnTimer;
+    tick.rng = gameRng;
+   
+    // The entities go in now, before the move eats anything; the header is filled in after
+    unsigned int at = rewindEnd + sizeof(RewindTick);
+    int n = entities.pickupCount;
+    RewindCopy(at, entities.pickupCell, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindCopy(at, entities.pickupKind, n); at += n;
+    RewindCopy(at, entities.pickupLife, n * sizeof(float)); at += n * sizeof(float);
+    n = entities.wallCount;
+    RewindCopy(at, entities.wallStart, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindCopy(at, entities.wallEnd, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindCopy(at, entities.wallTimer, n * sizeof(float)); at += n * sizeof(float);
+    RewindCopy(at, entities.wallCountdown, n); at += n;
+    RewindCopy(at, entities.wallCellCount, n); at += n;
+    for (int w = 0; w < n; w++) {
+        RewindCopy(at, entities.wallCells[w], entities.wallCellCount[w] * sizeof(Cell));
+        at += entities.wallCellCount[w] * sizeof(Cell);
+    }
+   
+    unsigned int headSeq = snake.headSeq;
+    int oldLength = snake.length;
+    int eaten = modeKernel->moveSnake();
+    if (snake.headSeq == headSeq) return eaten;  // Blocked, nothing moved
+   
+    tick.head = SnakeCell(0);
+    tick.growth = snake.length - oldLength;
+    RewindCopy(rewindEnd, &tick, sizeof(tick));
+    rewindStart[rewindLast % REWIND_TICKS] = rewindEnd;
+    rewindLast++;
+    rewindEnd = at;
+    rewindMilliseconds += tick.speed;
+    return eaten;
+}
+
+// Undoes the newest recorded move
+void PopRewindTick() {
+    rewindLast--;
+    unsigned int at = rewindStart[rewindLast % REWIND_TICKS];
+    rewindEnd = at;
+    RewindTick tick;
+    RewindFetch(at, &tick, sizeof(tick));
+    at += sizeof(tick);
+   
+    if (tick.growth == 0) {
+        AppendSnakeTail(tick.tail);
+    } else {
+        for (int i = 1; i < tick.growth; i++) DropSnakeTail();
+    }
+    PopSnakeHead();
+    snake.dx = tick.dx;
+    snake.dy = tick.dy;
+    speed = tick.speed;
+    timeAttackTimer = tick.timeAttackTimer;
+    gameRng = tick.rng;
+    rewindMilliseconds -= tick.speed;
+   
+    // Pickups are restored wholesale, so both the old and the restored cells need redrawing
+    for (int i = 0; i < entities.pickupCount; i++) MarkBoardCell(entities.pickupCell[i]);
+    int n = entities.pickupCount = tick.pickupCount;
+    RewindFetch(at, entities.pickupCell, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindFetch(at, entities.pickupKind, n); at += n;
+    RewindFetch(at, entities.pickupLife, n * sizeof(float)); at += n * sizeof(float);
+   
+    // Walls are swapped cell by cell so connectivity follows without a relabel
+    for (int w = 0; w < entities.wallCount; w++) {
+        for (int i = 0; i < entities.wallCellCount[w]; i++) UncoverWallCell(entities.wallCells[w][i]);
+    }
+    n = entities.wallCount = tick.wallCount;
+    RewindFetch(at, entities.wallStart, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindFetch(at, entities.wallEnd, n * sizeof(Cell)); at += n * sizeof(Cell);
+    RewindFetch(at, entities.wallTimer, n * sizeof(float)); at += n * sizeof(float);
+    RewindFetch(at, entities.wallCountdown, n); at += n;
+    RewindFetch(at, entities.wallCellCount, n); at += n;
+    for (int w = 0; w < n; w++) {
+        RewindFetch(at, entities.wallCells[w], entities.wallCellCount[w] * sizeof(Cell));
+        at += entities.wallCellCount[w] * sizeof(Cell);
+        for (int i = 0; i < entities.wallCellCount[w]; i++) CoverWallCell(entities.wallCells[w][i]);
+    }
+    entities.wallSpawnTimer = tick.wallSpawnTimer;
+    RebuildPickupGrid();
+    for (int i = 0; i < entities.pickupCount; i++) MarkBoardCell(entities.pickupCell[i]);
+}
+
+// Runs history backwards at REWIND_SPEEDUP times the pace it was played
+void StepRewind(float deltaTime) {
+    rewindBudget += deltaTime * 1000.0f * REWIND_SPEEDUP;
+    while (rewindLast != rewindFirst) {
+        RewindTick newest;
+        RewindFetch(rewindStart[(rewindLast - 1) % REWIND_TICKS], &newest, sizeof(newest));
+        if (rewindBudget < newest.speed) break;
+        rewindBudget -= newest.speed;
+        PopRewindTick();
+    }
+    if (rewindLast == rewindFirst) rewindBudget = 0;
+    lastUpdateTime = gameClock;  // Play resumes a full move after letting go
+}
+
+// ---------------------------------------------------------------------------
+// Snake Arena: many snakes on one large board. Every snake writes its cells
+// into one shared occupancy grid, so collision and food checks are a single
+// grid lookup per head and the tick cost grows linearly with the snake count.
+// ---------------------------------------------------------------------------
+
+unsigned int ArenaSnakeCell(const ArenaSnake* s, int i) {
+    return s->body[(s->head - i) & (ARENA_SNAKE_MAX_LENGTH - 1)];
+}
+
+void InitArenaColors() {
+    for (int i = 0; i < ARENA_MAX_SNAKES; i++) {
+        arenaColors[i] = i == arenaPlayer ? accentColor1 : ColorFromHSV(fmodf(i * 137.5f, 360.0f), 0.55f, 0.95f);
+    }
+   
+    // Local players get the game's own accents so their snakes stand out from the AI
+    Color coopColors[COOP_MAX_PLAYERS] = { accentColor1, accentColor2, accentColor3, (Color){ 215, 160, 235, 255 } };
+    for (int i = 0; i < coopPlayers; i++) {
+        arenaColors[i] = coopColors[i];
+    }
+}
+
+// Direction codes shared by the event log and the wire format
+int ArenaDirectionCode(int from, int to) {
+    int delta = to - from;
+    if (delta == 1) return 0;
+    if (delta == ARENA_WIDTH) return 1;
+    if (delta == -1) return 2;
+    return 3;
+}
+
+int ArenaDirectionDelta(int code) {
+    static const int deltas[4] = { 1, ARENA_WIDTH, -1, -ARENA_WIDTH };
+    return deltas[code & 3];
+}
+
+void PutArenaEventBytes(const unsigned char* bytes, int count) {
+    if (arenaEventBytes + count > arenaEventCapacity) {
+        arenaEventOverflow = 1;
+        return;
+    }
+    memcpy(arenaEventLog + arenaEventBytes, bytes, count);
+    arenaEventBytes += count;
+}
+
+// Head moves, tail retractions, deaths and food spawns, 3-4 bytes each
+void ArenaEvent(ArenaEventType type, int value, int extra) {
+    if (arenaEventLog == NULL) return;
+    unsigned char e[4];
+    e[0] = (unsigned char)(type << 4 | (extra & 0x0F));
+    if (type == ARENA_EVENT_FOOD) {
+        e[1] = value & 0xFF;
+        e[2] = (value >> 8) & 0xFF;
+        e[3] = (value >> 16) & 0xFF;
+        PutArenaEventBytes(e, 4);
+    } else {
+        e[1] = value & 0xFF;
+        e[2] = (value >> 8) & 0xFF;
+        PutArenaEventBytes(e, 3);
+    }
+}
+
+// A whole body: tail cell, length and 2-bit steps towards the head
+void ArenaBodyEvent(int id) {
+    if (arenaEventLog == NULL) return;
+    const ArenaSnake* s = &arena.snakes[id];
+    unsigned char e[10 + ARENA_SNAKE_MAX_LENGTH / 4];
+    int tail = ArenaSnakeCell(s, s->length - 1);
+    int n = 0;
+    e[n++] = ARENA_EVENT_BODY << 4;
+    e[n++] = id & 0xFF;
+    e[n++] = (id >> 8) & 0xFF;
+    e[n++] = tail & 0xFF;
+    e[n++] = (tail >> 8) & 0xFF;
+    e[n++] = (tail >> 16) & 0xFF;
+    e[n++] = s->length & 0xFF;
+    e[n++] = (s->length >> 8) & 0xFF;
+    memset(e + n, 0, (s->length + 2) / 4);
+    for (int i = s->length - 1; i > 0; i--) {
+        int step = s->length - 1 - i;
+        int code = ArenaDirectionCode(ArenaSnakeCell(s, i), ArenaSnakeCell(s, i - 1));
+        e[n + step / 4] |= code << ((step % 4) * 2);
+    }
+    n += (s->length + 2) / 4;
+    PutArenaEventBytes(e, n);
+}
+
+// Replays a change log onto the local arena; returns 0 on malformed input
+int ApplyArenaEvents(const unsigned char* data, int size) {
+    int p = 0;
+    while (p < size) {
+        int type = data[p] >> 4;
+        int extra = data[p] & 0x0F;
+        if (type == ARENA_EVENT_FOOD) {
+            if (p + 4 > size) return 0;
+            int cell = data[p + 1] | data[p + 2] << 8 | data[p + 3] << 16;
+            if (cell >= ARENA_CELLS) return 0;
+            arena.grid[cell] = ARENA_CELL_FOOD;
+            p += 4;
+            continue;
+        }
+       
+        if (p + 3 > size) return 0;
+        int id = data[p + 1] | data[p + 2] << 8;
+        if (id >= ARENA_MAX_SNAKES) return 0;
+        ArenaSnake* s = &arena.snakes[id];
+        p += 3;
+       
+        if (type == ARENA_EVENT_HEAD) {
+            int cell = ArenaSnakeCell(s, 0) + ArenaDirectionDelta(extra);
+            if (!s->alive || cell < 0 || cell >= ARENA_CELLS) return 0;
+            s->head = (s->head + 1) & (ARENA_SNAKE_MAX_LENGTH - 1);
+            s->body[s->head] = cell;
+            s->length++;
+            arena.grid[cell] = id + 1;
+        } else if (type == ARENA_EVENT_TAIL) {
+            if (!s->alive || s->length < 1) return 0;
+            int cell = ArenaSnakeCell(s, s->length - 1);
+            if (arena.grid[cell] == id + 1) arena.grid[cell] = ARENA_CELL_EMPTY;
+            s->length--;
+        } else if (type == ARENA_EVENT_DEATH) {
+            if (!s->alive) return 0;
+            for (int i = 0; i < s->length; i++) {
+                int cell = ArenaSnakeCell(s, i);
+                if (arena.grid[cell] == id + 1) arena.grid[cell] = ARENA_CELL_EMPTY;
+            }
+            s->alive = 0;
+            arena.aliveCount--;
+        } else if (type == ARENA_EVENT_BODY) {
+            if (p + 5 > size) return 0;
+            int cell = data[p] | data[p + 1] << 8 | data[p + 2] << 16;
+            int length = data[p + 3] | data[p + 4] << 8;
+            p += 5;
+            if (length < 1 || length > ARENA_SNAKE_MAX_LENGTH || cell >= ARENA_CELLS) return 0;
+            if (p + (length + 2) / 4 > size) return 0;
+            if (!s->alive) arena.aliveCount++;
+            s->alive = 1;
+            s->length = length;
+            s->head = length - 1;
+            for (int i = 0; i < length; i++) {
+                if (i > 0) {
+                    cell += ArenaDirectionDelta(data[p + (i - 1) / 4] >> (((i - 1) % 4) * 2));
+                    if (cell < 0 || cell >= ARENA_CELLS) return 0;
+                }
+                s->body[i] = cell;
+                arena.grid[cell] = id + 1;
+            }
+            p += (length + 2) / 4;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int IsArenaCellBlocked(int x, int y) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) return 1;
+    unsigned short v = arena.grid[y * ARENA_WIDTH + x];
+    return v != ARENA_CELL_EMPTY && v < ARENA_CELL_FOOD;
+}
+
+int AddArenaFood(int cell) {
+    if (arena.foodFreeCount == 0 || arena.grid[cell] != ARENA_CELL_EMPTY) return 0;
+    int slot = arena.foodFree[--arena.foodFreeCount];
+    arena.foodCells[slot] = cell;
+    arena.grid[cell] = ARENA_CELL_FOOD + slot;
+    arena.foodActive++;
+    ArenaEvent(ARENA_EVENT_FOOD, cell, 0);
+    return 1;
+}
+
+void RemoveArenaFood(int slot) {
+    arena.grid[arena.foodCells[slot]] = ARENA_CELL_EMPTY;
+    arena.foodCells[slot] = -1;
+    arena.foodFree[arena.foodFreeCount++] = slot;
+    arena.foodActive--;
+}
+
+int SpawnArenaSnake(int id) {
+    ArenaSnake* s = &arena.snakes[id];
+   
+    // Look for a free horizontal run so the new snake starts heading right
+    for (int attempt = 0; attempt < 32; attempt++) {
+        int x, y;
+        if ((id == arenaPlayer || id < coopPlayers) && attempt == 0) {
+            x = ARENA_WIDTH / 2;
+            y = ARENA_HEIGHT / 2 + id * 8;  // Local players line up near the centre
+        } else {
+            x = SimRandomRange(&arena.rng, ARENA_START_LENGTH + 1, ARENA_WIDTH - 8);
+            y = SimRandomRange(&arena.rng, 1, ARENA_HEIGHT - 2);
+        }
+       
+        int free = 1;
+        for (int i = -ARENA_START_LENGTH; i <= 4 && free; i++) {
+            if (arena.grid[y * ARENA_WIDTH + x + i] != ARENA_CELL_EMPTY) free = 0;
+        }
+        if (!free) continue;
+       
+        s->length = ARENA_START_LENGTH;
+        s->head = ARENA_START_LENGTH - 1;
+        for (int i = 0; i < ARENA_START_LENGTH; i++) {
+            int cell = y * ARENA_WIDTH + x - i;
+            s->body[s->head - i] = cell;
+            arena.grid[cell] = id + 1;
+        }
+        s->dx = 1;
+        s->dy = 0;
+        s->alive = 1;
+        s->targetFood = -1;
+        arena.aliveCount++;
+        ArenaBodyEvent(id);
+        return 1;
+    }
+    return 0;
+}
+
+void KillArenaSnake(int id) {
+    ArenaSnake* s = &arena.snakes[id];
+    ArenaEvent(ARENA_EVENT_DEATH, id, 0);
+   
+    // The body dissolves into food for the survivors
+    for (int i = 0; i < s->length; i++) {
+        int cell = ArenaSnakeCell(s, i);
+        if (arena.grid[cell] != id + 1) continue;
+        arena.grid[cell] = ARENA_CELL_EMPTY;
+        if (i % 2 == 0) AddArenaFood(cell);
+    }
+   
+    if (s->length > s->best) s->best = s->length;
+    s->alive = 0;
+    s->respawnTimer = ARENA_RESPAWN_TICKS;
+    arena.aliveCount--;
+}
+
+void InitArena() {
+    memset(arena.grid, 0, sizeof(arena.grid));
+    arena.foodFreeCount = 0;
+    for (int i = ARENA_FOOD_CAPACITY - 1; i >= 0; i--) {
+        arena.foodCells[i] = -1;
+        arena.foodFree[arena.foodFreeCount++] = i;
+    }
+    arena.foodActive = 0;
+    arena.tick = 0;
+    arena.aliveCount = 0;
+    arena.tickAccumulator = 0;
+    arena.tickMs = 0;
+    arena.rng = SeedRandom((unsigned int)time(NULL));
+   
+    for (int i = 0; i < ARENA_MAX_SNAKES; i++) {
+        memset(&arena.snakes[i], 0, sizeof(ArenaSnake));
+        arena.snakes[i].movedTick = -1;
+        SpawnArenaSnake(i);
+    }
+    if (arenaPlayer >= 0) {
+        arena.snakes[arenaPlayer].human = 1;
+    }
+    for (int i = 0; i < coopPlayers; i++) {
+        arena.snakes[i].human = 1;
+    }
+    InitArenaColors();
+   
+    while (arena.foodActive < ARENA_FOOD_TARGET) {
+        AddArenaFood(SimRandomRange(&arena.rng, 0, ARENA_CELLS - 1));
+    }
+}
+
+void SteerArenaSnake(int id) {
+    ArenaSnake* s = &arena.snakes[id];
+    unsigned int headCell = ArenaSnakeCell(s, 0);
+    int hx = headCell % ARENA_WIDTH;
+    int hy = headCell / ARENA_WIDTH;
+   
+    // Retarget when the food we were chasing is gone: sample a few slots, keep the nearest
+    if (s->targetFood < 0 || arena.foodCells[s->targetFood] < 0) {
+        int bestDistance = ARENA_WIDTH + ARENA_HEIGHT;
+        s->targetFood = -1;
+        for (int i = 0; i < 8; i++) {
+            int slot = SimRandomRange(&arena.rng, 0, ARENA_FOOD_CAPACITY - 1);
+            if (arena.foodCells[slot] < 0) continue;
+            int fx = arena.foodCells[slot] % ARENA_WIDTH;
+            int fy = arena.foodCells[slot] / ARENA_WIDTH;
+            int distance = abs(fx - hx) + abs(fy - hy);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                s->targetFood = slot;
+            }
+        }
+    }
+   
+    int tx = hx + s->dx * 8;
+    int ty = hy + s->dy * 8;
+    if (s->targetFood >= 0) {
+        tx = arena.foodCells[s->targetFood] % ARENA_WIDTH;
+        ty = arena.foodCells[s->targetFood] / ARENA_WIDTH;
+    }
+   
+    // Candidates: straight, left turn, right turn
+    int options[3][2] = { { s->dx, s->dy }, { s->dy, -s->dx }, { -s->dy, s->dx } };
+    int bestScore = 1 << 30;
+    int bestOption = 0;
+    for (int i = 0; i < 3; i++) {
+        int nx = hx + options[i][0];
+        int ny = hy + options[i][1];
+        if (IsArenaCellBlocked(nx, ny)) continue;
+        int score = (abs(tx - nx) + abs(ty - ny)) * 4 + SimRandomRange(&arena.rng, 0, 3);
+        if (score < bestScore) {
+            bestScore = score;
+            bestOption = i;
+        }
+    }
+    s->dx = options[bestOption][0];
+    s->dy = options[bestOption][1];
+}
+
+void StepArena() {
+    static int nextCells[ARENA_MAX_SNAKES];
+    static int growing[ARENA_MAX_SNAKES];
+    static int dying[ARENA_MAX_SNAKES];
+    arena.tick++;
+   
+    // Decide moves against the grid as it was at the start of the tick
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        ArenaSnake* s = &arena.snakes[id];
+        nextCells[id] = -1;
+        dying[id] = 0;
+        if (!s->alive) continue;
+        if (!s->human) SteerArenaSnake(id);
+       
+        unsigned int headCell = ArenaSnakeCell(s, 0);
+        int nx = headCell % ARENA_WIDTH + s->dx;
+        int ny = headCell / ARENA_WIDTH + s->dy;
+        if (nx < 0 || nx >= ARENA_WIDTH || ny < 0 || ny >= ARENA_HEIGHT) {
+            dying[id] = 1;
+            continue;
+        }
+        nextCells[id] = ny * ARENA_WIDTH + nx;
+        growing[id] = arena.grid[nextCells[id]] >= ARENA_CELL_FOOD && s->length < ARENA_SNAKE_MAX_LENGTH;
+    }
+   
+    // Retract tails first so snakes may follow each other nose to tail
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        ArenaSnake* s = &arena.snakes[id];
+        if (nextCells[id] < 0 || growing[id]) continue;
+        arena.grid[ArenaSnakeCell(s, s->length - 1)] = ARENA_CELL_EMPTY;
+        s->length--;
+        ArenaEvent(ARENA_EVENT_TAIL, id, 0);
+    }
+   
+    // Advance heads; a single grid lookup resolves body, head-to-head and food hits
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        ArenaSnake* s = &arena.snakes[id];
+        int cell = nextCells[id];
+        if (cell < 0) continue;
+       
+        unsigned short v = arena.grid[cell];
+        if (v != ARENA_CELL_EMPTY && v < ARENA_CELL_FOOD) {
+            int other = v - 1;
+            ArenaSnake* o = &arena.snakes[other];
+            dying[id] = 1;
+            if (other != id) {
+                if (o->movedTick == arena.tick && ArenaSnakeCell(o, 0) == (unsigned int)cell) {
+                    dying[other] = 1;  // Head-to-head: both lose
+                } else {
+                    o->kills++;
+                }
+            }
+            continue;
+        }
+       
+        if (v >= ARENA_CELL_FOOD) {
+            RemoveArenaFood(v - ARENA_CELL_FOOD);
+        }
+        ArenaEvent(ARENA_EVENT_HEAD, id, ArenaDirectionCode(ArenaSnakeCell(s, 0), cell));
+        s->head = (s->head + 1) & (ARENA_SNAKE_MAX_LENGTH - 1);
+        s->body[s->head] = cell;
+        s->length++;
+        s->movedTick = arena.tick;
+        arena.grid[cell] = id + 1;
+    }
+   
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        if (dying[id] && arena.snakes[id].alive) KillArenaSnake(id);
+    }
+   
+    // Respawns and food top-up
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        ArenaSnake* s = &arena.snakes[id];
+        if (!s->alive && --s->respawnTimer <= 0) {
+            SpawnArenaSnake(id);
+        }
+    }
+   
+    for (int i = 0; i < ARENA_FOOD_SPAWNS_PER_TICK && arena.foodActive < ARENA_FOOD_TARGET; i++) {
+        AddArenaFood(SimRandomRange(&arena.rng, 0, ARENA_CELLS - 1));
+    }
+}
+
+void UpdateArena(float deltaTime) {
+    if (paused) return;
+   
+    arena.tickAccumulator += deltaTime;
+    int steps = 0;
+    while (arena.tickAccumulator >= ARENA_TICK_MS / 1000.0f) {
+        arena.tickAccumulator -= ARENA_TICK_MS / 1000.0f;
+        if (steps++ >= ARENA_MAX_TICKS_PER_FRAME) {
+            arena.tickAccumulator = 0;  // Drop the backlog instead of spiralling
+            break;
+        }
+       
+        // Local players' turns count from the moment this tick was due, however late the frame ran
+        if (coopPlayers > 0) {
+            ApplyCoopInputs(MonotonicSeconds() - arena.tickAccumulator);
+        }
+       
+        double start = GetTime();
+        StepArena();
+        float elapsed = (float)((GetTime() - start) * 1000.0);
+        arena.tickMs = arena.tickMs * 0.9f + elapsed * 0.1f;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Local co-op (--coop N): up to four players share the arena on one machine,
+// each with a snake and a viewport of their own. The keyboard is polled by a
+// dedicated thread into per-player queues of timestamped turns, and every
+// arena tick takes the turns made before it was due, so a slow frame neither
+// delays nor drops anyone's turn. GLFW only reads input on the main thread,
+// so the input thread asks the X server for the keymap itself; without X the
+// frame loop samples the keys instead. Gamepads are read once per frame.
+// ---------------------------------------------------------------------------
+
+// A full queue drops the newest turn; the player is pressing faster than ticks can use them
+void PushInput(InputQueue* queue, double time, int direction) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail >= INPUT_QUEUE_EVENTS) return;
+    queue->events[head & (INPUT_QUEUE_EVENTS - 1)] = (InputEvent){ time, direction };
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+}
+
+// Oldest queued turn, or NULL when there is none
+InputEvent* PeekInput(InputQueue* queue) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    return tail == head ? NULL : &queue->events[tail & (INPUT_QUEUE_EVENTS - 1)];
+}
+
+void PopInput(InputQueue* queue) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+void ClearInputQueues() {
+    for (int p = 0; p < COOP_MAX_PLAYERS; p++) {
+        for (int source = 0; source < 2; source++) {
+            while (PeekInput(&inputQueues[p][source]) != NULL) PopInput(&inputQueues[p][source]);
+        }
+    }
+}
+
+// Gives each local player the earliest usable turn made before tickTime, at most one per tick
+void ApplyCoopInputs(double tickTime) {
+    for (int p = 0; p < coopPlayers; p++) {
+        ArenaSnake* s = &arena.snakes[p];
+        unsigned int head = ArenaSnakeCell(s, 0);
+        unsigned int neck = ArenaSnakeCell(s, 1);
+        int movingVertically = head / ARENA_WIDTH != neck / ARENA_WIDTH;
+       
+        for (;;) {
+            // Keyboard and gamepad queues are merged in the order the turns were made
+            InputEvent* keyboard = PeekInput(&inputQueues[p][0]);
+            InputEvent* gamepad = PeekInput(&inputQueues[p][1]);
+            int source = gamepad != NULL && (keyboard == NULL || gamepad->time < keyboard->time);
+            InputEvent* event = source ? gamepad : keyboard;
+            if (event == NULL || event->time > tickTime) break;
+           
+            int direction = event->direction;
+            int stale = tickTime - event->time > INPUT_MAX_AGE;
+            PopInput(&inputQueues[p][source]);
+           
+            // Turns made while dead, into the neck or along the current line are used up without effect
+            if (stale || !s->alive || (reachDy[direction] != 0) == movingVertically) continue;
+            s->dx = reachDx[direction];
+            s->dy = reachDy[direction];
+            break;
+        }
+    }
+}
+
+#ifndef _WIN32
+
+void* InputThreadMain(void* unused) {
+    (void)unused;
+    char keys[32];
+    char previous[32] = { 0 };
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+   
+    while (atomic_load_explicit(&inputThreadRunning, memory_order_acquire)) {
+        inputQueryKeymap(inputDisplay, keys);
+        double now = MonotonicSeconds();
+        if (!atomic_load_explicit(&inputFocused, memory_order_relaxed)) {
+            memset(keys, 0, sizeof(keys));  // Typing into another window is not a turn
+        }
+       
+        // Only presses count; a held key turns once, like a tap
+        for (int p = 0; p < coopPlayers; p++) {
+            for (int d = 0; d < 4; d++) {
+                int code = inputKeycodes[p][d];
+                int bit = 1 << (code & 7);
+                if (code != 0 && (keys[code >> 3] & bit) && !(previous[code >> 3] & bit)) {
+                    PushInput(&inputQueues[p][0], now, d);
+                }
+            }
+        }
+        memcpy(previous, keys, sizeof(keys));
+        atomic_fetch_add_explicit(&inputSamples, 1, memory_order_relaxed);
+       
+        deadline.tv_nsec += 1000000000L / INPUT_SAMPLE_HZ;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+    return NULL;
+}
+
+// Returns 1 when the keyboard is now polled off the main thread
+int StartInputThread() {
+    if (inputThreaded) return 1;
+    inputLibrary = dlopen("libX11.so.6", RTLD_NOW | RTLD_LOCAL);
+    if (inputLibrary == NULL) return 0;
+   
+    void* (*openDisplay)(const char*) = (void* (*)(const char*))dlsym(inputLibrary, "XOpenDisplay");
+    unsigned char (*keysymToKeycode)(void*, unsigned long) =
+        (unsigned char (*)(void*, unsigned long))dlsym(inputLibrary, "XKeysymToKeycode");
+    inputQueryKeymap = (int (*)(void*, char*))dlsym(inputLibrary, "XQueryKeymap");
+    inputCloseDisplay = (int (*)(void*))dlsym(inputLibrary, "XCloseDisplay");
+    if (openDisplay == NULL || keysymToKeycode == NULL || inputQueryKeymap == NULL || inputCloseDisplay == NULL ||
+        (inputDisplay = openDisplay(NULL)) == NULL) {
+        dlclose(inputLibrary);
+        return 0;
+    }
+   
+    for (int p = 0; p < COOP_MAX_PLAYERS; p++) {
+        for (int d = 0; d < 4; d++) {
+            inputKeycodes[p][d] = keysymToKeycode(inputDisplay, coopKeysyms[p][d]);
+        }
+    }
+    ClearInputQueues();
+    atomic_store(&inputThreadRunning, 1);
+    if (pthread_create(&inputThread, NULL, InputThreadMain, NULL) != 0) {
+        inputCloseDisplay(inputDisplay);
+        dlclose(inputLibrary);
+        return 0;
+    }
+    inputThreaded = 1;
+    return 1;
+}
+
+void StopInputThread() {
+    if (!inputThreaded) return;
+    atomic_store_explicit(&inputThreadRunning, 0, memory_order_release);
+    pthread_join(inputThread, NULL);
+    inputCloseDisplay(inputDisplay);
+    dlclose(inputLibrary);
+    inputThreaded = 0;
+}
+
+#else
+
+int StartInputThread() {
+    return 0;
+}
+
+void StopInputThread() {
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Versus: deterministic 1v1 on the classic board. The whole match lives in a
+// small VersusState and only advances through StepVersus, which reads nothing
+// but the state and the two inputs, so peers can rewind and replay it freely.
+// ---------------------------------------------------------------------------
+
+int VersusCell(const VersusState* v, int p, int i) {
+    return v->body[p][(v->head[p] - i) & (VERSUS_MAX_LENGTH - 1)];
+}
+
+int IsVersusCellOccupied(const VersusState* v, int cell) {
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < v->length[p]; i++) {
+            if (VersusCell(v, p, i) == cell) return 1;
+        }
+    }
+    return 0;
+}
+
+void SpawnVersusFood(VersusState* v) {
+    for (int attempt = 0; attempt < 64; attempt++) {
+        int cell = SimRandomRange(&v->rng, 0, BOARD_COLS * BOARD_ROWS - 1);
+        if (!IsVersusCellOccupied(v, cell)) {
+            v->food = cell;
+            return;
+        }
+    }
+    for (int cell = 0; cell < BOARD_COLS * BOARD_ROWS; cell++) {
+        if (!IsVersusCellOccupied(v, cell)) {
+            v->food = cell;
+            return;
+        }
+    }
+}
+
+void InitVersusState(VersusState* v, unsigned int seed) {
+    memset(v, 0, sizeof(VersusState));
+    v->rng = SeedRandom(seed);
+    for (int p = 0; p < 2; p++) {
+        v->length[p] = 3;
+        v->head[p] = 2;
+        v->alive[p] = 1;
+        v->direction[p] = p == 0 ? 0 : 2;
+        for (int i = 0; i < 3; i++) {
+            int x = p == 0 ? 2 + i : BOARD_COLS - 3 - i;
+            v->body[p][i] = (BOARD_ROWS / 2) * BOARD_COLS + x;
+        }
+    }
+    SpawnVersusFood(v);
+}
+
+void StepVersus(VersusState* v, const unsigned char input[2]) {
+    static const int dx[4] = { 1, 0, -1, 0 };
+    static const int dy[4] = { 0, 1, 0, -1 };
+    int next[2] = { -1, -1 };
+    int grow[2] = { 0, 0 };
+    int dead[2] = { 0, 0 };
+   
+    if (!v->alive[0] || !v->alive[1]) return;  // The round is decided; the state stays frozen
+    v->tick++;
+   
+    for (int p = 0; p < 2; p++) {
+        int dir = input[p] & 3;
+        if ((dir ^ v->direction[p]) == 2) dir = v->direction[p];  // No reversing into the neck
+        v->direction[p] = dir;
+       
+        int cell = VersusCell(v, p, 0);
+        int x = cell % BOARD_COLS + dx[dir];
+        int y = cell / BOARD_COLS + dy[dir];
+        if (x < 0 || x >= BOARD_COLS || y < 0 || y >= BOARD_ROWS) {
+            dead[p] = 1;
+            continue;
+        }
+        next[p] = y * BOARD_COLS + x;
+        grow[p] = next[p] == v->food && v->length[p] < VERSUS_MAX_LENGTH;
+    }
+   
+    // Bodies block, except tails that move out of the way this tick
+    for (int p = 0; p < 2; p++) {
+        if (next[p] < 0) continue;
+        for (int q = 0; q < 2; q++) {
+            int solid = v->length[q] - (grow[q] ? 0 : 1);
+            for (int i = 0; i < solid; i++) {
+                if (VersusCell(v, q, i) == next[p]) dead[p] = 1;
+            }
+        }
+    }
+    if (next[0] >= 0 && next[0] == next[1]) {
+        dead[0] = dead[1] = 1;
+    }
+   
+    int ate = 0;
+    for (int p = 0; p < 2; p++) {
+        if (dead[p]) {
+            v->alive[p] = 0;
+            continue;
+        }
+        v->head[p] = (v->head[p] + 1) & (VERSUS_MAX_LENGTH - 1);
+        v->body[p][v->head[p]] = next[p];
+        if (grow[p]) {
+            v->length[p]++;
+            ate = 1;
+        }
+    }
+    if (ate) SpawnVersusFood(v);
+}
+
+// FNV-1a over the fields (not the padding) so peers can compare confirmed states
+unsigned int VersusChecksum(const VersusState* v) {
+    unsigned int hash = 2166136261u;
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < v->length[p]; i++) {
+            hash = (hash ^ VersusCell(v, p, i)) * 16777619u;
+        }
+        hash = (hash ^ v->direction[p]) * 16777619u;
+        hash = (hash ^ v->alive[p]) * 16777619u;
+    }
+    hash = (hash ^ v->food) * 16777619u;
+    hash = (hash ^ v->rng) * 16777619u;
+    hash = (hash ^ (unsigned int)v->tick) * 16777619u;
+    return hash;
+}
+
+// ---------------------------------------------------------------------------
+// Networked arena. A headless server owns the rules and sends each client
+// the change log since the last tick that client acknowledged; clients
+// mirror the arena by replaying those logs and predict their own head.
+// ---------------------------------------------------------------------------
+
+void PutU16(unsigned char* p, int v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+void PutU32(unsigned char* p, unsigned int v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+int GetU16(const unsigned char* p) {
+    return p[0] | p[1] << 8;
+}
+
+unsigned int GetU32(const unsigned char* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int)p[3] << 24;
+}
+
+#ifndef _WIN32
+
+typedef struct {
+    struct sockaddr_storage address;
+    socklen_t addressLength;
+    int active;
+    int snake;
+    int ackTick;  // Last tick the peer confirmed, 0 until its first full snapshot lands
+    double lastHeard;
+    long bytesSent;
+} NetPeer;
+
+// Set by SIGINT/SIGTERM so the headless server and bots leave their loops and shut down cleanly
+volatile sig_atomic_t netStopRequested = 0;
+
+void RequestNetStop(int signal) {
+    (void)signal;
+    netStopRequested = 1;
+}
+
+// No SA_RESTART, so a signal also cuts the poll or sleep it lands in short
+void CatchNetStopSignals() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = RequestNetStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+double NetNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int OpenUdpSocket(int port) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return -1;
+   
+    if (port > 0) {
+        struct sockaddr_in local = { 0 };
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0) {
+            close(sock);
+            return -1;
+        }
+    }
+   
+    int bufferSize = 4 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    return sock;
+}
+
+int ResolveAddress(const char* host, int port, struct sockaddr_storage* out, socklen_t* outLength) {
+    struct addrinfo hints = { 0 };
+    struct addrinfo* result = NULL;
+    char service[16];
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    sprintf(service, "%d", port);
+    if (getaddrinfo(host, service, &hints, &result) != 0 || result == NULL) return 0;
+    memcpy(out, result->ai_addr, result->ai_addrlen);
+    *outLength = result->ai_addrlen;
+    freeaddrinfo(result);
+    return 1;
+}
+
+void WriteServerHeader(unsigned char* packet, int kind, int tick, int baseTick, int snake) {
+    packet[0] = 'S';
+    packet[1] = kind;
+    PutU32(packet + 2, tick);
+    PutU32(packet + 6, baseTick);
+    PutU16(packet + 10, snake);
+    PutU16(packet + 12, arena.snakes[snake].kills);
+}
+
+void WriteClientPacket(unsigned char* packet, int kind, int ackTick, int dx, int dy) {
+    packet[0] = 'C';
+    packet[1] = kind;
+    PutU32(packet + 2, ackTick);
+    packet[6] = (unsigned char)(signed char)dx;
+    packet[7] = (unsigned char)(signed char)dy;
+    memset(packet + 8, 0, NET_CLIENT_PACKET - 8);
+}
+
+// Full state as a change log: every live body plus every food cell
+int BuildFullSnapshot(unsigned char* packet, int snake) {
+    WriteServerHeader(packet, NET_FULL, arena.tick, 0, snake);
+    arenaEventLog = packet + NET_SERVER_HEADER;
+    arenaEventBytes = 0;
+    arenaEventCapacity = NET_MAX_PACKET - NET_SERVER_HEADER;
+    arenaEventOverflow = 0;
+   
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        if (arena.snakes[id].alive) ArenaBodyEvent(id);
+    }
+    for (int slot = 0; slot < ARENA_FOOD_CAPACITY; slot++) {
+        if (arena.foodCells[slot] >= 0) ArenaEvent(ARENA_EVENT_FOOD, arena.foodCells[slot], 0);
+    }
+   
+    int size = NET_SERVER_HEADER + arenaEventBytes;
+    arenaEventLog = NULL;
+    return arenaEventOverflow ? 0 : size;
+}
+
+int RunArenaServer(int port) {
+    static unsigned char history[NET_HISTORY_TICKS][NET_HISTORY_BYTES];
+    static int historyBytes[NET_HISTORY_TICKS];
+    static int historyTick[NET_HISTORY_TICKS];
+    static unsigned char packet[NET_MAX_PACKET];
+    static NetPeer peers[NET_MAX_PEERS];
+   
+    int sock = OpenUdpSocket(port);
+    if (sock < 0) {
+        fprintf(stderr, "Could not open UDP port %d\n", port);
+        return 1;
+    }
+    printf("Arena server listening on UDP port %d (%d ms ticks)\n", port, ARENA_TICK_MS);
+    CatchNetStopSignals();
+   
+    arenaPlayer = -1;
+    InitArena();
+    memset(historyTick, -1, sizeof(historyTick));
+   
+    double nextTick = NetNow();
+    double statsTime = nextTick + 1.0;
+    double simTotal = 0, simMax = 0, netTotal = 0;
+    int ticksSinceStats = 0;
+   
+    while (!netStopRequested) {
+        double now = NetNow();
+        int waitMs = (int)((nextTick - now) * 1000.0);
+        struct pollfd pfd = { sock, POLLIN, 0 };
+        poll(&pfd, 1, waitMs > 0 ? waitMs : 0);
+       
+        // Drain client packets: handshakes, inputs and acks
+        for (;;) {
+            struct sockaddr_storage from;
+            socklen_t fromLength = sizeof(from);
+            int n = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*)&from, &fromLength);
+            if (n < 0) break;
+            if (n < NET_CLIENT_PACKET || packet[0] != 'C') continue;
+           
+            NetPeer* peer = NULL;
+            NetPeer* freePeer = NULL;
+            for (int i = 0; i < NET_MAX_PEERS; i++) {
+                if (peers[i].active && peers[i].addressLength == fromLength &&
+                    memcmp(&peers[i].address, &from, fromLength) == 0) {
+                    peer = &peers[i];
+                    break;
+                }
+                if (!peers[i].active && freePeer == NULL) freePeer = &peers[i];
+            }
+           
+            if (peer == NULL) {
+                if (packet[1] != NET_HELLO || freePeer == NULL) continue;
+               
+                // Take over the lowest snake nobody is driving yet
+                int snake = 0;
+                while (snake < ARENA_MAX_SNAKES && arena.snakes[snake].human) snake++;
+                if (snake == ARENA_MAX_SNAKES) continue;
+               
+                peer = freePeer;
+                memset(peer, 0, sizeof(NetPeer));
+                memcpy(&peer->address, &from, fromLength);
+                peer->addressLength = fromLength;
+                peer->active = 1;
+                peer->snake = snake;
+                arena.snakes[snake].human = 1;
+            }
+           
+            peer->lastHeard = NetNow();
+            if (packet[1] == NET_BYE) {
+                arena.snakes[peer->snake].human = 0;
+                peer->active = 0;
+                continue;
+            }
+           
+            // An ack of 0 means the client lost sync and wants a full snapshot
+            int ack = (int)GetU32(packet + 2);
+            if (ack == 0 || (ack > peer->ackTick && ack <= arena.tick)) peer->ackTick = ack;
+           
+            // Steering is only accepted if it does not fold the head back onto the neck
+            ArenaSnake* s = &arena.snakes[peer->snake];
+            int dx = (signed char)packet[6];
+            int dy = (signed char)packet[7];
+            if (s->alive && abs(dx) + abs(dy) == 1 &&
+                (int)ArenaSnakeCell(s, 0) + dx + dy * ARENA_WIDTH != (int)ArenaSnakeCell(s, 1)) {
+                s->dx = dx;
+                s->dy = dy;
+            }
+        }
+       
+        now = NetNow();
+        if (now < nextTick) continue;
+        nextTick += ARENA_TICK_MS / 1000.0;
+        if (now - nextTick > 1.0) nextTick = now;  // Do not replay a long stall
+       
+        // Simulate one tick while capturing its change log
+        int slot = (arena.tick + 1) % NET_HISTORY_TICKS;
+        arenaEventLog = history[slot];
+        arenaEventBytes = 0;
+        arenaEventCapacity = NET_HISTORY_BYTES;
+        arenaEventOverflow = 0;
+        double simStart = NetNow();
+        StepArena();
+        double simElapsed = NetNow() - simStart;
+        arenaEventLog = NULL;
+        historyTick[slot] = arena.tick;
+        historyBytes[slot] = arenaEventOverflow ? -1 : arenaEventBytes;
+       
+        // Per peer: everything since its ack, or a full snapshot when that is gone
+        double netStart = NetNow();
+        for (int i = 0; i < NET_MAX_PEERS; i++) {
+            NetPeer* peer = &peers[i];
+            if (!peer->active) continue;
+            if (now - peer->lastHeard > NET_PEER_TIMEOUT) {
+                arena.snakes[peer->snake].human = 0;
+                peer->active = 0;
+                continue;
+            }
+           
+            int size = 0;
+            if (peer->ackTick > 0 && arena.tick - peer->ackTick < NET_HISTORY_TICKS) {
+                size = NET_SERVER_HEADER;
+                for (int t = peer->ackTick + 1; t <= arena.tick && size > 0; t++) {
+                    int h = t % NET_HISTORY_TICKS;
+                    if (historyTick[h] != t || historyBytes[h] < 0 ||
+                        size + historyBytes[h] > NET_MAX_PACKET) {
+                        size = 0;
+                        break;
+                    }
+                    memcpy(packet + size, history[h], historyBytes[h]);
+                    size += historyBytes[h];
+                }
+                if (size > 0) WriteServerHeader(packet, NET_DELTA, arena.tick, peer->ackTick, peer->snake);
+            }
+            if (size == 0) size = BuildFullSnapshot(packet, peer->snake);
+            if (size == 0) continue;
+           
+            sendto(sock, packet, size, 0, (struct sockaddr*)&peer->address, peer->addressLength);
+            peer->bytesSent += size;
+        }
+        double netElapsed = NetNow() - netStart;
+       
+        simTotal += simElapsed;
+        netTotal += netElapsed;
+        if (simElapsed > simMax) simMax = simElapsed;
+        ticksSinceStats++;
+       
+        if (now >= statsTime) {
+            int peerCount = 0;
+            long bytes = 0;
+            for (int i = 0; i < NET_MAX_PEERS; i++) {
+                if (!peers[i].active) continue;
+                peerCount++;
+                bytes += peers[i].bytesSent;
+                peers[i].bytesSent = 0;
+            }
+            double seconds = now - statsTime + 1.0;
+            printf("tick %6d | clients %3d | sim %.3f ms avg %.3f max | send %.3f ms | %.1f KB/s per client, %.1f KB/s total\n",
+                   arena.tick, peerCount,
+                   simTotal * 1000.0 / ticksSinceStats, simMax * 1000.0,
+                   netTotal * 1000.0 / ticksSinceStats,
+                   peerCount ? bytes / 1024.0 / seconds / peerCount : 0.0,
+                   bytes / 1024.0 / seconds);
+            fflush(stdout);
+            simTotal = simMax = netTotal = 0;
+            ticksSinceStats = 0;
+            statsTime = now + 1.0;
+        }
+    }
+   
+    // Clients notice the silence and fall back to their own timeouts
+    int peerCount = 0;
+    for (int i = 0; i < NET_MAX_PEERS; i++) {
+        if (peers[i].active) peerCount++;
+    }
+    close(sock);
+    printf("Arena server stopped at tick %d with %d clients connected\n", arena.tick, peerCount);
+    return 0;
+}
+
+// Headless load generator: each bot is a full client that steers at random
+int RunArenaBots(int count, const char* host, int port) {
+    static unsigned char packet[NET_MAX_PACKET];
+    struct sockaddr_storage server;
+    socklen_t serverLength;
+    if (count < 1 || count > NET_MAX_PEERS || !ResolveAddress(host, port, &server, &serverLength)) {
+        fprintf(stderr, "Usage: --bots <1-%d> [host] [port]\n", NET_MAX_PEERS);
+        return 1;
+    }
+   
+    int* sockets = malloc(count * sizeof(int));
+    int* ticks = calloc(count, sizeof(int));
+    int* directions = calloc(count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        sockets[i] = OpenUdpSocket(0);
+        WriteClientPacket(packet, NET_HELLO, 0, 1, 0);
+        sendto(sockets[i], packet, NET_CLIENT_PACKET, 0, (struct sockaddr*)&server, serverLength);
+    }
+    printf("%d bots connected to %s:%d\n", count, host, port);
+   
+    srand(time(NULL));
+    long bytesReceived = 0;
+    double statsTime = NetNow() + 1.0;
+    static const int dirs[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    CatchNetStopSignals();
+   
+    while (!netStopRequested) {
+        usleep(ARENA_TICK_MS * 1000 / 2);
+       
+        for (int i = 0; i < count; i++) {
+            int n;
+            while ((n = recv(sockets[i], packet, sizeof(packet), 0)) >= NET_SERVER_HEADER) {
+                bytesReceived += n;
+                int tick = (int)GetU32(packet + 2);
+                int base = (int)GetU32(packet + 6);
+                if (packet[1] == NET_FULL || (packet[1] == NET_DELTA && base == ticks[i])) ticks[i] = tick;
+            }
+           
+            if (rand() % 8 == 0) directions[i] = (directions[i] + (rand() % 2 ? 1 : 3)) % 4;
+            WriteClientPacket(packet, NET_INPUT, ticks[i], dirs[directions[i]][0], dirs[directions[i]][1]);
+            sendto(sockets[i], packet, NET_CLIENT_PACKET, 0, (struct sockaddr*)&server, serverLength);
+        }
+       
+        double now = NetNow();
+        if (now >= statsTime) {
+            printf("bots %d | %.1f KB/s per bot received\n", count, bytesReceived / 1024.0 / count);
+            fflush(stdout);
+            bytesReceived = 0;
+            statsTime = now + 1.0;
+        }
+    }
+   
+    // Hand the snakes back to the AI straight away instead of waiting for the server's timeout
+    for (int i = 0; i < count; i++) {
+        WriteClientPacket(packet, NET_BYE, ticks[i], 0, 0);
+        sendto(sockets[i], packet, NET_CLIENT_PACKET, 0, (struct sockaddr*)&server, serverLength);
+        close(sockets[i]);
+    }
+    free(sockets);
+    free(ticks);
+    free(directions);
+    printf("%d bots disconnected\n", count);
+    return 0;
+}
+
+int NetConnect(const char* host, int port) {
+    struct sockaddr_storage server;
+    socklen_t serverLength;
+    if (!ResolveAddress(host, port, &server, &serverLength)) return 0;
+   
+    memset(&netSession, 0, sizeof(netSession));
+    netSession.socket = OpenUdpSocket(0);
+    if (netSession.socket < 0) return 0;
+    memcpy(netSession.address, &server, serverLength);
+    netSession.addressLength = serverLength;
+    netSession.active = 1;
+   
+    // Start from an empty mirror; the first full snapshot fills it in
+    memset(arena.grid, 0, sizeof(arena.grid));
+    memset(arena.snakes, 0, sizeof(arena.snakes));
+    arena.aliveCount = 0;
+    arena.tickMs = 0;
+    arenaPlayer = 0;
+    InitArenaColors();
+   
+    unsigned char packet[NET_CLIENT_PACKET];
+    WriteClientPacket(packet, NET_HELLO, 0, 1, 0);
+    sendto(netSession.socket, packet, sizeof(packet), 0, (struct sockaddr*)netSession.address, netSession.addressLength);
+    return 1;
+}
+
+void NetDisconnect() {
+    if (!netSession.active) return;
+    unsigned char packet[NET_CLIENT_PACKET];
+    WriteClientPacket(packet, NET_BYE, netSession.tick, 0, 0);
+    sendto(netSession.socket, packet, sizeof(packet), 0, (struct sockaddr*)netSession.address, netSession.addressLength);
+    close(netSession.socket);
+    netSession.active = 0;
+    arenaPlayer = 0;
+}
+
+void NetClientUpdate() {
+    static unsigned char packet[NET_MAX_PACKET];
+    double now = GetTime();
+    int n;
+   
+    while ((n = recv(netSession.socket, packet, sizeof(packet), 0)) >= 0) {
+        netSession.bytesReceived += n;
+        if (n < NET_SERVER_HEADER || packet[0] != 'S') continue;
+       
+        int tick = (int)GetU32(packet + 2);
+        int baseTick = (int)GetU32(packet + 6);
+        int snake = GetU16(packet + 10);
+        if (snake >= ARENA_MAX_SNAKES) continue;
+       
+        if (packet[1] == NET_FULL) {
+            if (tick <= netSession.tick) continue;
+            memset(arena.grid, 0, sizeof(arena.grid));
+            for (int i = 0; i < ARENA_MAX_SNAKES; i++) arena.snakes[i].alive = 0;
+            arena.aliveCount = 0;
+        } else if (packet[1] != NET_DELTA || baseTick != netSession.tick) {
+            continue;  // Stale or out of order; the next delta covers it
+        }
+       
+        if (snake != arenaPlayer) {
+            int dx = arena.snakes[arenaPlayer].dx;
+            int dy = arena.snakes[arenaPlayer].dy;
+            arenaPlayer = snake;
+            arena.snakes[snake].dx = dx;
+            arena.snakes[snake].dy = dy;
+            InitArenaColors();
+        }
+        if (!ApplyArenaEvents(packet + NET_SERVER_HEADER, n - NET_SERVER_HEADER)) {
+            netSession.tick = 0;  // Ask for a fresh full snapshot
+            continue;
+        }
+       
+        // Reconcile: did the server put our head where we predicted it for this tick?
+        ArenaSnake* self = &arena.snakes[arenaPlayer];
+        int predicted = tick - netSession.predictedFrom - 1;
+        if (packet[1] == NET_DELTA && self->alive && predicted >= 0 && predicted < netSession.predictedCount &&
+            ArenaSnakeCell(self, 0) != netSession.predictedCells[predicted]) {
+            netSession.corrections++;
+        }
+        netSession.tick = tick;
+        netSession.kills = GetU16(packet + 12);
+        netSession.snapshotTime = now;
+    }
+   
+    // Every frame: current steering plus the ack that drives the next delta
+    ArenaSnake* player = &arena.snakes[arenaPlayer];
+    WriteClientPacket(packet, NET_INPUT, netSession.tick, player->dx, player->dy);
+    sendto(netSession.socket, packet, NET_CLIENT_PACKET, 0, (struct sockaddr*)netSession.address, netSession.addressLength);
+   
+    if (now - netSession.statsTime >= 1.0) {
+        netSession.kilobytesPerSecond = netSession.bytesReceived / 1024.0f / (float)(now - netSession.statsTime);
+        netSession.bytesReceived = 0;
+        netSession.statsTime = now;
+    }
+}
+
+#else
+
+int RunArenaServer(int port) {
+    fprintf(stderr, "The arena server needs POSIX sockets and is not available on this platform\n");
+    return 1;
+}
+
+int RunArenaBots(int count, const char* host, int port) {
+    fprintf(stderr, "Arena bots need POSIX sockets and are not available on this platform\n");
+    return 1;
+}
+
+int NetConnect(const char* host, int port) {
+    return 0;
+}
+
+void NetDisconnect() {
+}
+
+void NetClientUpdate() {
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Rollback netcode for Versus. Each peer runs ahead on its own inputs and a
+// prediction of the remote ones (repeat the last known direction). When a
+// remote input arrives that contradicts the prediction, the saved state for
+// that tick is restored and the ticks since are re-simulated in one frame.
+// ---------------------------------------------------------------------------
+
+unsigned char VersusRemoteInput(int tick) {
+    int slot = tick & (ROLLBACK_RING - 1);
+    return versus.remoteTags[slot] == tick ? versus.remoteInputs[slot] : versus.lastRemote;
+}
+
+// The newest state every input is known for: safe to compare and to end the match on
+int VersusConfirmedTick() {
+    return versus.remoteTick < versus.tick ? versus.remoteTick : versus.tick;
+}
+
+VersusState* VersusCurrentState() {
+    return &versus.states[versus.tick & (ROLLBACK_RING - 1)];
+}
+
+VersusState* VersusConfirmedState() {
+    return &versus.states[VersusConfirmedTick() & (ROLLBACK_RING - 1)];
+}
+
+void StartVersus() {
+    VersusState* start = &versus.states[0];
+    InitVersusState(start, versus.seed);
+    memset(versus.localTags, -1, sizeof(versus.localTags));
+    memset(versus.remoteTags, -1, sizeof(versus.remoteTags));
+   
+    // The first few ticks run before any input can arrive; both peers know they go straight
+    int remote = 1 - versus.player;
+    for (int t = 0; t < VERSUS_INPUT_DELAY; t++) {
+        versus.localInputs[t] = start->direction[versus.player];
+        versus.localTags[t] = t;
+        versus.remoteInputs[t] = start->direction[remote];
+        versus.remoteTags[t] = t;
+    }
+    versus.localDirection = start->direction[versus.player];
+    versus.lastRemote = start->direction[remote];
+    versus.tick = 0;
+    versus.remoteTick = VERSUS_INPUT_DELAY;
+    versus.remoteAck = 0;
+    versus.accumulator = 0;
+    versus.started = 1;
+}
+
+#ifndef _WIN32
+
+int VersusConnect(int localPort, const char* host, int peerPort, float delayMs, float jitterMs, float lossPercent) {
+    struct sockaddr_storage peer;
+    socklen_t peerLength;
+    if (!ResolveAddress(host, peerPort, &peer, &peerLength)) return 0;
+   
+    memset(&versus, 0, sizeof(versus));
+    versus.socket = OpenUdpSocket(localPort);
+    if (versus.socket < 0) return 0;
+    memcpy(versus.address, &peer, peerLength);
+    versus.addressLength = peerLength;
+   
+    // The lower port plays the left snake and picks the seed
+    versus.player = localPort < peerPort ? 0 : 1;
+    versus.seed = versus.player == 0 ? (unsigned int)time(NULL) : 0;
+    versus.delayMs = delayMs;
+    versus.jitterMs = jitterMs;
+    versus.lossPercent = lossPercent;
+    versus.active = 1;
+    return 1;
+}
+
+void VersusDisconnect() {
+    if (!versus.active) return;
+    close(versus.socket);
+    versus.active = 0;
+}
+
+// Outgoing packets pass through the simulated link: dropped, or held back by delay plus jitter
+void QueueVersusPacket(const unsigned char* data, int size) {
+    if (versus.lossPercent > 0 && rand() % 10000 < (int)(versus.lossPercent * 100)) return;
+    if (versus.delayMs <= 0 && versus.jitterMs <= 0) {
+        sendto(versus.socket, data, size, 0, (struct sockaddr*)versus.address, versus.addressLength);
+        return;
+    }
+    if (versus.queued == VERSUS_MAX_QUEUED) return;
+   
+    DelayedPacket* packet = &versus.queue[versus.queued++];
+    memcpy(packet->data, data, size);
+    packet->size = size;
+    packet->sendTime = NetNow() + (versus.delayMs + versus.jitterMs * (rand() % 1001) / 1000.0f) / 1000.0;
+}
+
+void FlushVersusQueue() {
+    double now = NetNow();
+    int kept = 0;
+    for (int i = 0; i < versus.queued; i++) {
+        DelayedPacket* packet = &versus.queue[i];
+        if (packet->sendTime <= now) {
+            sendto(versus.socket, packet->data, packet->size, 0, (struct sockaddr*)versus.address, versus.addressLength);
+        } else {
+            versus.queue[kept++] = *packet;
+        }
+    }
+    versus.queued = kept;
+}
+
+// Every unacknowledged local input goes out in each packet, so a lost packet costs nothing
+void SendVersusInputs() {
+    unsigned char packet[VERSUS_HEADER + VERSUS_PACKET_INPUTS];
+    int first = versus.remoteAck;
+    int count = 0;
+    if (versus.started) {
+        while (count < VERSUS_PACKET_INPUTS && first + count < versus.tick + VERSUS_INPUT_DELAY) {
+            int slot = (first + count) & (ROLLBACK_RING - 1);
+            if (versus.localTags[slot] != first + count) break;
+            packet[VERSUS_HEADER + count] = versus.localInputs[slot];
+            count++;
+        }
+    }
+   
+    int confirmed = versus.started ? VersusConfirmedTick() : 0;
+    packet[0] = 'V';
+    packet[1] = versus.player;
+    PutU32(packet + 2, versus.seed);
+    PutU32(packet + 6, first);
+    packet[10] = count;
+    PutU32(packet + 11, versus.started ? versus.remoteTick : 0);
+    PutU32(packet + 15, confirmed);
+    PutU32(packet + 19, versus.started ? VersusChecksum(&versus.states[confirmed & (ROLLBACK_RING - 1)]) : 0);
+    QueueVersusPacket(packet, VERSUS_HEADER + count);
+}
+
+// Returns the earliest tick whose prediction turned out wrong, or INT_MAX
+int ReceiveVersusInputs() {
+    unsigned char packet[256];
+    int rollbackFrom = 0x7FFFFFFF;
+    int remote = 1 - versus.player;
+    int n;
+   
+    while ((n = recv(versus.socket, packet, sizeof(packet), 0)) >= 0) {
+        if (n < VERSUS_HEADER || packet[0] != 'V' || packet[1] != remote) continue;
+        int count = packet[10];
+        if (n < VERSUS_HEADER + count) continue;
+       
+        if (!versus.started) {
+            if (versus.player == 1) versus.seed = GetU32(packet + 2);
+            StartVersus();
+        }
+       
+        int ack = (int)GetU32(packet + 11);
+        if (ack > versus.remoteAck) versus.remoteAck = ack;
+       
+        int first = (int)GetU32(packet + 6);
+        for (int i = 0; i < count; i++) {
+            int t = first + i;
+            int slot = t & (ROLLBACK_RING - 1);
+            if (t < versus.remoteTick || versus.remoteTags[slot] == t) continue;
+            if (t >= versus.tick + ROLLBACK_RING / 2) break;
+           
+            versus.remoteInputs[slot] = packet[VERSUS_HEADER + i];
+            versus.remoteTags[slot] = t;
+            if (t < versus.tick && versus.inputs[slot][remote] != packet[VERSUS_HEADER + i] && t < rollbackFrom) {
+                rollbackFrom = t;
+            }
+        }
+        while (versus.remoteTags[versus.remoteTick & (ROLLBACK_RING - 1)] == versus.remoteTick) {
+            versus.lastRemote = versus.remoteInputs[versus.remoteTick & (ROLLBACK_RING - 1)];
+            versus.remoteTick++;
+        }
+       
+        // Both peers hash their confirmed states; any difference means the simulation diverged
+        int checkTick = (int)GetU32(packet + 15);
+        if (checkTick > 0 && checkTick <= VersusConfirmedTick() && checkTick > versus.tick - ROLLBACK_RING &&
+            VersusChecksum(&versus.states[checkTick & (ROLLBACK_RING - 1)]) != GetU32(packet + 19)) {
+            versus.desynced = 1;
+        }
+    }
+    return rollbackFrom;
+}
+
+void PumpVersus() {
+    double now = NetNow();
+    if (now - versus.lastSend >= 1.0 / 120.0) {
+        SendVersusInputs();
+        versus.lastSend = now;
+    }
+    FlushVersusQueue();
+}
+
+void UpdateVersus(float deltaTime) {
+    int remote = 1 - versus.player;
+    int rollbackFrom = ReceiveVersusInputs();
+   
+    if (!versus.started) {
+        PumpVersus();
+        return;
+    }
+   
+    // Rewind to the first mispredicted tick and replay up to the present
+    if (rollbackFrom < versus.tick) {
+        for (int t = rollbackFrom; t < versus.tick; t++) {
+            int slot = t & (ROLLBACK_RING - 1);
+            int next = (t + 1) & (ROLLBACK_RING - 1);
+            versus.inputs[slot][remote] = VersusRemoteInput(t);
+            versus.states[next] = versus.states[slot];
+            StepVersus(&versus.states[next], versus.inputs[slot]);
+        }
+        int depth = versus.tick - rollbackFrom;
+        versus.rollbacks++;
+        if (depth > versus.deepestRollback) versus.deepestRollback = depth;
+    }
+   
+    versus.accumulator += deltaTime;
+    if (versus.accumulator > 4 * VERSUS_TICK_MS / 1000.0) versus.accumulator = 4 * VERSUS_TICK_MS / 1000.0;
+    while (versus.accumulator >= VERSUS_TICK_MS / 1000.0) {
+        // Never predict further than a rollback can repair; wait for the peer instead
+        if (versus.tick - versus.remoteTick >= ROLLBACK_MAX_TICKS) {
+            versus.stalls++;
+            break;
+        }
+        versus.accumulator -= VERSUS_TICK_MS / 1000.0;
+       
+        int ahead = (versus.tick + VERSUS_INPUT_DELAY) & (ROLLBACK_RING - 1);
+        versus.localInputs[ahead] = versus.localDirection;
+        versus.localTags[ahead] = versus.tick + VERSUS_INPUT_DELAY;
+       
+        int slot = versus.tick & (ROLLBACK_RING - 1);
+        int next = (versus.tick + 1) & (ROLLBACK_RING - 1);
+        versus.inputs[slot][versus.player] = versus.localInputs[slot];
+        versus.inputs[slot][remote] = VersusRemoteInput(versus.tick);
+        versus.states[next] = versus.states[slot];
+        StepVersus(&versus.states[next], versus.inputs[slot]);
+        versus.tick++;
+    }
+   
+    PumpVersus();
+   
+    VersusState* confirmed = VersusConfirmedState();
+    if (!confirmed->alive[0] || !confirmed->alive[1]) {
+        currentState = GAME_OVER;
+    }
+}
+
+#else
+
+int VersusConnect(int localPort, const char* host, int peerPort, float delayMs, float jitterMs, float lossPercent) {
+    return 0;
+}
+
+void VersusDisconnect() {
+}
+
+void PumpVersus() {
+}
+
+void UpdateVersus(float deltaTime) {
+}
+
+#endif
+
+int IsRetractedCell(unsigned int cell) {
+    for (int i = 0; i < netSession.retractedCount; i++) {
+        if (netSession.retractedCells[i] == cell) return 1;
+    }
+    return 0;
+}
+
+int IsPredictedFree(unsigned int cell) {
+    if (IsRetractedCell(cell)) return 1;
+    for (int i = 0; i < netSession.predictedCount; i++) {
+        if (netSession.predictedCells[i] == cell) return 0;
+    }
+    unsigned short v = arena.grid[cell];
+    return v == ARENA_CELL_EMPTY || v >= ARENA_CELL_FOOD;
+}
+
+// Client-side prediction: every frame our own moves past the last snapshot are re-run from it with
+// StepArena's move rule and the steering we sent for each tick. A new snapshot therefore replaces
+// whatever was predicted for the ticks it covers, and only the moves still ahead of it are replayed.
+// Anything the client cannot know (others' moves, deaths) is left to the next snapshot.
+void PredictLocalSnake() {
+    ArenaSnake* s = &arena.snakes[arenaPlayer];
+    netSession.predictedFrom = netSession.tick;
+    netSession.predictedCount = 0;
+    netSession.retractedCount = 0;
+    if (!netSession.active || netSession.tick == 0 || !s->alive) return;
+    int ahead = (int)((GetTime() - netSession.snapshotTime) * 1000.0 / ARENA_TICK_MS);
+    if (ahead > NET_MAX_PREDICTION) ahead = NET_MAX_PREDICTION;
+   
+    // The server's next tick takes whatever steering it heard last; earlier ticks keep theirs
+    int next = netSession.tick + ahead + 1;
+    netSession.inputTick[next & (NET_INPUT_RING - 1)] = next;
+    netSession.inputDx[next & (NET_INPUT_RING - 1)] = s->dx;
+    netSession.inputDy[next & (NET_INPUT_RING - 1)] = s->dy;
+   
+    unsigned int head = ArenaSnakeCell(s, 0);
+    int length = s->length;
+    for (int t = netSession.tick + 1; t < next; t++) {
+        int slot = t & (NET_INPUT_RING - 1);
+        int dx = netSession.inputTick[slot] == t ? netSession.inputDx[slot] : s->dx;
+        int dy = netSession.inputTick[slot] == t ? netSession.inputDy[slot] : s->dy;
+        int x = head % ARENA_WIDTH + dx;
+        int y = head / ARENA_WIDTH + dy;
+        if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) break;  // Into the edge
+        unsigned int cell = y * ARENA_WIDTH + x;
+       
+        // As in StepArena the tail retracts before the head arrives, unless the move eats
+        int growing = arena.grid[cell] >= ARENA_CELL_FOOD && length < ARENA_SNAKE_MAX_LENGTH;
+        // Short snakes run out of snapshot body and start retracting their own predicted cells
+        if (!growing) {
+            int tail = s->length - 1 - netSession.retractedCount;
+            netSession.retractedCells[netSession.retractedCount] =
+                tail >= 0 ? ArenaSnakeCell(s, tail) : netSession.predictedCells[-tail - 1];
+            netSession.retractedCount++;
+        }
+        if (!IsPredictedFree(cell)) {
+            if (!growing) netSession.retractedCount--;
+            break;  // A hit; who dies is the server's call
+        }
+        netSession.predictedCells[netSession.predictedCount++] = cell;
+        if (growing) length++;
+        head = cell;
+    }
+}
+
+void HandleFrontPageInput() {
+    Vector2 mousePoint = GetMousePosition();
+   
+    // Check if start button is hovered
+    if (CheckCollisionPointRec(mousePoint, startButton.rect)) {
+        startButton.hover = true;
+        if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
+            currentState = MENU;
+        }
+    } else {
+        startButton.hover = false;
+    }
+   
+    // Check if exit button is hovered
+    if (CheckCollisionPointRec(mousePoint, exitButton.rect)) {
+        exitButton.hover = true;
+        if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
+            CloseWindow();
+        }
+    } else {
+        exitButton.hover = false;
+    }
+   
+    // Start game with Enter or Space key
+    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
+        currentState = MENU;
+    }
+   
+    // Exit with Escape key - quit the game
+    if (IsKeyPressed(KEY_ESCAPE)) {
+        CloseWindow();
+    }
+}
+
+void HandleMenuInput() {
+    Vector2 mousePoint = GetMousePosition();
+   
+    for (int i = 0; i < numOptions; i++) {
+        if (CheckCollisionPointRec(mousePoint, menuButtons[i].rect)) {
+            menuButtons[i].hover = true;
+            if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
+                selectedOption = i;
+                selectedMode = (GameMode)i;
+                currentState = COUNTDOWN;
+                countdownTimer = COUNTDOWN_DURATION;
+            }
+        } else {
+            menuButtons[i].hover = false;
+        }
+    }
+
+    if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
+        selectedOption = (selectedOption + 1) % numOptions;
+    }
+   
+    if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
+        selectedOption = (selectedOption - 1 + numOptions) % numOptions;
+    }
+   
+    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
+        selectedMode = (GameMode)selectedOption;
+        currentState = COUNTDOWN;
+        countdownTimer = COUNTDOWN_DURATION;
+    }
+   
+    // ESC goes back to front page
+    if (IsKeyPressed(KEY_ESCAPE)) {
+        currentState = FRONT_PAGE;
+    }
+}
+
+void HandleArenaInput() {
+    ArenaSnake* player = &arena.snakes[arenaPlayer];
+    if (paused || !player->alive) return;
+   
+    // Guard against reversing into the neck using the direction of the last move, predicted or not
+    int predicted = netSession.active ? netSession.predictedCount : 0;
+    unsigned int head = predicted > 0 ? netSession.predictedCells[predicted - 1] : ArenaSnakeCell(player, 0);
+    unsigned int neck = predicted > 1 ? netSession.predictedCells[predicted - 2] : ArenaSnakeCell(player, predicted > 0 ? 0 : 1);
+    int movingVertically = head / ARENA_WIDTH != neck / ARENA_WIDTH;
+   
+    if ((IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) && !movingVertically) {
+        player->dx = 0;
+        player->dy = -1;
+    }
+    if ((IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) && !movingVertically) {
+        player->dx = 0;
+        player->dy = 1;
+    }
+    if ((IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) && movingVertically) {
+        player->dx = -1;
+        player->dy = 0;
+    }
+    if ((IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) && movingVertically) {
+        player->dx = 1;
+        player->dy = 0;
+    }
+}
+
+// Queues each local player's turns; the arena tick decides when they take effect
+void HandleCoopInput() {
+    atomic_store_explicit(&inputFocused, IsWindowFocused(), memory_order_relaxed);
+    double now = MonotonicSeconds();
+    const int buttons[4] = {
+        GAMEPAD_BUTTON_LEFT_FACE_RIGHT, GAMEPAD_BUTTON_LEFT_FACE_DOWN,
+        GAMEPAD_BUTTON_LEFT_FACE_LEFT, GAMEPAD_BUTTON_LEFT_FACE_UP
+    };
+    for (int p = 0; p < coopPlayers; p++) {
+        for (int d = 0; d < 4; d++) {
+            if (!inputThreaded && IsKeyPressed(coopKeys[p][d])) {
+                PushInput(&inputQueues[p][0], now, d);
+            }
+            if (IsGamepadAvailable(p) && IsGamepadButtonPressed(p, buttons[d])) {
+                PushInput(&inputQueues[p][1], now, d);
+            }
+        }
+    }
+   
+    // Keyboard polling rate for the HUD, measured over half a second
+    if (now - inputRateStart >= 0.5) {
+        inputRate = inputThreaded ? atomic_exchange(&inputSamples, 0) / (now - inputRateStart) : GetFPS();
+        inputRateStart = now;
+    }
+}
+
+void HandleVersusInput() {
+    // Only the intent is recorded; StepVersus rejects reversals deterministically on both peers
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) versus.localDirection = 0;
+    if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) versus.localDirection = 1;
+    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) versus.localDirection = 2;
+    if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) versus.localDirection = 3;
+}
+
+void HandleGameInput() {
+    // Online games keep running on the other end, so they cannot pause
+    if (IsKeyPressed(KEY_P) && !netSession.active && !versus.active) {
+        paused = !paused;
+        if (paused) SaveGameSnapshot();
+    }
+    rewinding = !paused && currentMode <= MAZE && (IsKeyDown(KEY_R) || IsKeyDown(KEY_BACKSPACE));
+    if (currentMode == ARENA && coopPlayers > 0) {
+        HandleCoopInput();
+    } else if (currentMode == ARENA) {
+        HandleArenaInput();
+    } else if (currentMode == VERSUS) {
+        HandleVersusInput();
+    } else if (!paused) {
+        if ((IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) && snake.dy == 0) {
+            snake.dx = 0;
+            snake.dy = -1;
+        }
+        if ((IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) && snake.dy == 0) {
+            snake.dx = 0;
+            snake.dy = 1;
+        }
+        if ((IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) && snake.dx == 0) {
+            snake.dx = -1;
+            snake.dy = 0;
+        }
+        if ((IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) && snake.dx == 0) {
+            snake.dx = 1;
+            snake.dy = 0;
+        }
+    }
+   
+    // Q key - go back to menu, keeping the game to resume on the next launch
+    if (IsKeyPressed(KEY_Q)) {
+        SaveGameSnapshot();
+        NetDisconnect();
+        VersusDisconnect();
+        StopInputThread();
+        coopPlayers = 0;
+        currentState = MENU;
+    }
+    
+    // ESC key - quit the game completely
+    if (IsKeyPressed(KEY_ESCAPE)) {
+        SaveGameSnapshot();
+        NetDisconnect();
+        VersusDisconnect();
+        StopInputThread();
+        CloseWindow();
+    }
+}
+
+void HandleGameOverInput() {
+    // Keep feeding a versus peer our last inputs until it has confirmed the result too
+    if (versus.active) {
+        PumpVersus();
+    }
+   
+    // ENTER or SPACE - return to menu
+    if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
+        VersusDisconnect();
+        currentState = MENU;
+    }
+    
+    // Q key - also go back to menu
+    if (IsKeyPressed(KEY_Q)) {
+        VersusDisconnect();
+        currentState = MENU;
+    }
+    
+    // ESC key - quit the game completely
+    if (IsKeyPressed(KEY_ESCAPE)) {
+        VersusDisconnect();
+        CloseWindow();
+    }
+}
+
+void UpdateCountdown(float deltaTime) {
+    countdownTimer -= deltaTime;
+    if (countdownTimer <= 0) {
+        ResetGame();
+        currentState = GAME;
+    }
+}
+
+void UpdateGame(float deltaTime) {
+    if (currentMode == ARENA) {
+        if (netSession.active) {
+            NetClientUpdate();
+            PredictLocalSnake();
+        } else {
+            UpdateArena(deltaTime);
+        }
+        return;
+    }
+    if (currentMode == VERSUS) {
+        UpdateVersus(deltaTime);
+        return;
+    }
+   
+    RecordReplayFrame(deltaTime);
+    if (rewinding) {
+        StepRewind(deltaTime);
+        return;
+    }
+   
+    if (!paused) {
+        modeKernel->step(deltaTime);
+        EmitWallSparks(deltaTime);
+        if (spawnedWall >= 0) ScheduleWallBeeps(spawnedWall, AudioNow());
+    }
+   
+    gameClock += deltaTime;
+    if (gameClock - lastUpdateTime > speed / 1000.0) {
+        double tickStart = TraceBegin();
+        int eaten = MoveSnakeRewindable();
+        TraceSpan("MoveSnake", tickStart, "length", snake.length);
+        if (eaten >= 0) {
+            EmitPickupBurst(SnakeCell(0), eaten);
+            PostSound(eaten == PICKUP_GOLDEN ? SFX_GOLDEN : SFX_EAT);
+        }
+        lastUpdateTime = gameClock;
+    }
+   
+    if (!running && modeKernel->endsOnDeath) {
+        EmitSnakeDissolve();
+        PostSound(SFX_DEATH);
+        DeleteGameSnapshot();  // A finished game has nothing to resume
+        StopReplayRecording();
+        RecordScore();
+        currentState = GAME_OVER;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// UI font: titles and HUD text use a TrueType font drawn from a signed
+// distance field atlas, so one small texture stays sharp at every size.
+// Building the atlas rasterizes every glyph, which is slow, so the result is
+// cached to disk and later launches map the cache and upload it as it is.
+// Without a font file (or a shader to draw it) text uses raylib's own font.
+// ---------------------------------------------------------------------------
+
+// Alpha holds the distance to the glyph outline, 0.5 on the edge
+const char* uiFontShaderCode =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "out vec4 finalColor;\n"
+    "uniform sampler2D texture0;\n"
+    "void main() {\n"
+    "    float distance = texture(texture0, fragTexCoord).a - 0.5;\n"
+    "    float width = max(length(vec2(dFdx(distance), dFdy(distance))), 1e-4);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * smoothstep(-width, width, distance));\n"
+    "}\n";
+
+// Draws every queued string in one shader pass. Switching shaders flushes raylib's batch, so text is
+// collected per pass instead of switching around each string; call this before anything that has to
+// cover the text, and before the render target or camera the text was queued under ends.
+void FlushUiText() {
+    if (uiTextCount == 0) return;
+    BeginShaderMode(uiFontShader);
+    for (int i = 0; i < uiTextCount; i++) {
+        UiTextRun* run = &uiTextRuns[i];
+        DrawTextEx(uiFont, uiTextChars + run->offset, (Vector2){ run->x, run->y }, run->fontSize,
+                   run->fontSize * UI_FONT_SPACING, run->color);
+    }
+    EndShaderMode();
+    uiTextCount = 0;
+    uiTextUsed = 0;
+}
+
+void DrawUiText(const char* text, int x, int y, int fontSize, Color color) {
+    if (!uiFontReady) {
+        DrawText(text, x, y, fontSize, color);
+        return;
+    }
+    int length = strlen(text) + 1;
+    if (uiTextCount == UI_TEXT_QUEUE || uiTextUsed + length > UI_TEXT_CHARS) {
+        FlushUiText();
+    }
+    if (length > UI_TEXT_CHARS) return;
+    memcpy(uiTextChars + uiTextUsed, text, length);
+    uiTextRuns[uiTextCount++] = (UiTextRun){ uiTextUsed, x, y, fontSize, color };
+    uiTextUsed += length;
+}
+
+int MeasureUiText(const char* text, int fontSize) {
+    if (!uiFontReady) return MeasureText(text, fontSize);
+    return (int)MeasureTextEx(uiFont, text, fontSize, fontSize * UI_FONT_SPACING).x;
+}
+
+// Takes the atlas from a mapped cache file; sourceSize is -1 when the TTF is gone and any cache will do
+int UseUiFontCache(const unsigned char* bytes, size_t length, long long sourceSize, long long sourceTime) {
+    const FontCacheHeader* header = (const FontCacheHeader*)bytes;
+    if (length < sizeof(FontCacheHeader) || memcmp(header->magic, "SNKF", 4) != 0 ||
+        header->version != UI_FONT_VERSION || header->baseSize != UI_FONT_SIZE ||
+        header->glyphCount != UI_FONT_GLYPHS) {
+        return 0;
+    }
+    if (sourceSize >= 0 && (header->sourceSize != sourceSize || header->sourceTime != sourceTime)) return 0;
+    if (header->width <= 0 || header->width > 4096 || header->height <= 0 || header->height > 4096 ||
+        header->pixelBytes == 0 ||
+        header->pixelBytes != (unsigned int)GetPixelDataSize(header->width, header->height, header->format) ||
+        length != sizeof(FontCacheHeader) + UI_FONT_GLYPHS * sizeof(FontCacheGlyph) + header->pixelBytes) {
+        return 0;
+    }
+   
+    const FontCacheGlyph* glyphs = (const FontCacheGlyph*)(header + 1);
+    uiFont.baseSize = UI_FONT_SIZE;
+    uiFont.glyphCount = UI_FONT_GLYPHS;
+    uiFont.glyphPadding = 0;
+    uiFont.glyphs = calloc(UI_FONT_GLYPHS, sizeof(GlyphInfo));  // No glyph images; only the atlas is drawn
+    uiFont.recs = malloc(UI_FONT_GLYPHS * sizeof(Rectangle));
+    if (uiFont.glyphs == NULL || uiFont.recs == NULL) {
+        free(uiFont.glyphs);
+        free(uiFont.recs);
+        return 0;
+    }
+    for (int i = 0; i < UI_FONT_GLYPHS; i++) {
+        uiFont.glyphs[i].value = glyphs[i].value;
+        uiFont.glyphs[i].offsetX = glyphs[i].offsetX;
+        uiFont.glyphs[i].offsetY = glyphs[i].offsetY;
+        uiFont.glyphs[i].advanceX = glyphs[i].advanceX;
+        uiFont.recs[i] = glyphs[i].rec;
+    }
+    Image atlas = { (void*)(glyphs + UI_FONT_GLYPHS), header->width, header->height, 1, header->format };
+    uiFont.texture = LoadTextureFromImage(atlas);
+    if (uiFont.texture.id == 0) {
+        free(uiFont.glyphs);
+        free(uiFont.recs);
+        return 0;
+    }
+    return 1;
+}
+
+int LoadUiFontCache(long long sourceSize, long long sourceTime) {
+    int loaded = 0;
+#ifndef _WIN32
+    int fd = open(UI_FONT_CACHE, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        const unsigned char* bytes = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (bytes != MAP_FAILED) {
+            loaded = UseUiFontCache(bytes, info.st_size, sourceSize, sourceTime);
+            munmap((void*)bytes, info.st_size);
+        }
+    }
+    close(fd);
+#else
+    int length = 0;
+    unsigned char* bytes = LoadFileData(UI_FONT_CACHE, &length);
+    if (bytes == NULL) return 0;
+    loaded = UseUiFontCache(bytes, length, sourceSize, sourceTime);
+    UnloadFileData(bytes);
+#endif
+    return loaded;
+}
+
+// Written beside the old cache and swapped in, so a crash never leaves half an atlas
+void WriteUiFontCache(Image atlas, long long sourceSize, long long sourceTime) {
+    FontCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKF", 4);
+    header.version = UI_FONT_VERSION;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.baseSize = UI_FONT_SIZE;
+    header.glyphCount = UI_FONT_GLYPHS;
+    header.width = atlas.width;
+    header.height = atlas.height;
+    header.format = atlas.format;
+    header.pixelBytes = GetPixelDataSize(atlas.width, atlas.height, atlas.format);
+   
+    FontCacheGlyph glyphs[UI_FONT_GLYPHS];
+    memset(glyphs, 0, sizeof(glyphs));
+    for (int i = 0; i < UI_FONT_GLYPHS; i++) {
+        glyphs[i].value = uiFont.glyphs[i].value;
+        glyphs[i].offsetX = uiFont.glyphs[i].offsetX;
+        glyphs[i].offsetY = uiFont.glyphs[i].offsetY;
+        glyphs[i].advanceX = uiFont.glyphs[i].advanceX;
+        glyphs[i].rec = uiFont.recs[i];
+    }
+   
+    FILE* file = fopen(UI_FONT_CACHE_TEMP, "wb");
+    if (file == NULL) return;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(glyphs, sizeof(glyphs), 1, file) == 1 &&
+             fwrite(atlas.data, header.pixelBytes, 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(UI_FONT_CACHE_TEMP);
+        return;
+    }
+#ifdef _WIN32
+    remove(UI_FONT_CACHE);  // rename() does not replace on Windows
+#endif
+    rename(UI_FONT_CACHE_TEMP, UI_FONT_CACHE);
+}
+
+// Rasterizes every glyph as a distance field and packs them into one atlas
+int BuildUiFont(long long sourceSize, long long sourceTime) {
+    int length = 0;
+    unsigned char* data = LoadFileData(uiFontPath, &length);
+    if (data == NULL) return 0;
+    uiFont.baseSize = UI_FONT_SIZE;
+    uiFont.glyphCount = UI_FONT_GLYPHS;
+    uiFont.glyphPadding = 0;
+    uiFont.glyphs = LoadFontData(data, length, UI_FONT_SIZE, NULL, UI_FONT_GLYPHS, FONT_SDF);
+    UnloadFileData(data);
+    if (uiFont.glyphs == NULL) return 0;
+   
+    Image atlas = GenImageFontAtlas(uiFont.glyphs, &uiFont.recs, UI_FONT_GLYPHS, UI_FONT_SIZE, 0, 1);
+    if (atlas.data == NULL) {
+        UnloadFontData(uiFont.glyphs, UI_FONT_GLYPHS);
+        return 0;
+    }
+    uiFont.texture = LoadTextureFromImage(atlas);
+    WriteUiFontCache(atlas, sourceSize, sourceTime);
+    UnloadImage(atlas);
+    return uiFont.texture.id != 0;
+}
+
+void LoadUiFont() {
+    double start = GetTime();
+    long long sourceSize = -1, sourceTime = 0;
+    if (FileExists(uiFontPath)) {
+        sourceSize = GetFileLength(uiFontPath);
+        sourceTime = GetFileModTime(uiFontPath);
+    }
+   
+    int cached = LoadUiFontCache(sourceSize, sourceTime);
+    if (!cached && (sourceSize < 0 || !BuildUiFont(sourceSize, sourceTime))) {
+        memset(&uiFont, 0, sizeof(uiFont));
+        return;
+    }
+    uiFontBuilt = !cached;
+    SetTextureFilter(uiFont.texture, TEXTURE_FILTER_BILINEAR);
+   
+    uiFontShader = LoadShaderFromMemory(NULL, uiFontShaderCode);
+    if (uiFontShader.id == 0 || uiFontShader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "UI font shader unavailable, using the built-in font");
+        UnloadFont(uiFont);
+        memset(&uiFont, 0, sizeof(uiFont));
+        return;
+    }
+    uiFontReady = 1;
+    TraceLog(LOG_INFO, "%s UI font in %.3f ms", cached ? "Loaded cached" : "Built and cached", (GetTime() - start) * 1000.0);
+}
+
+void UnloadUiFont() {
+    if (!uiFontReady) return;
+    UnloadShader(uiFontShader);
+    UnloadFont(uiFont);
+    uiFontReady = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Capture: while recording (F9) or after a screenshot request (F12) frames
+// are drawn into one of two render textures and shown from there. Each frame
+// reads back the texture filled the frame before, which the GPU has long
+// finished, so the readback never waits on the frame in flight. Read frames
+// go through a bounded ring to an encoder thread that writes PNGs or a Y4M
+// stream; when the ring is full the frame is dropped instead of waiting.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+// Converts a bottom-up RGBA frame into Y, U and V planes (w * h * 3 / 2 bytes)
+void ConvertToY4m(Image image, unsigned char* planes) {
+    int w = image.width, h = image.height;
+    unsigned char* y = planes;
+    unsigned char* u = planes + w * h;
+    unsigned char* v = u + (w / 2) * (h / 2);
+    const unsigned char* rgba = image.data;
+   
+    // Full-range BT.601, matching the C420jpeg header; render textures are bottom-up
+    for (int row = 0; row < h; row++) {
+        const unsigned char* src = rgba + (size_t)(h - 1 - row) * w * 4;
+        for (int col = 0; col < w; col++) {
+            y[row * w + col] = (unsigned char)(0.299f * src[col * 4] + 0.587f * src[col * 4 + 1] + 0.114f * src[col * 4 + 2]);
+        }
+    }
+    for (int row = 0; row < h / 2; row++) {
+        for (int col = 0; col < w / 2; col++) {
+            float r = 0, g = 0, b = 0;
+            for (int k = 0; k < 4; k++) {
+                const unsigned char* p = rgba + ((size_t)(h - 1 - (row * 2 + k / 2)) * w + col * 2 + k % 2) * 4;
+                r += p[0];
+                g += p[1];
+                b += p[2];
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            u[row * (w / 2) + col] = (unsigned char)(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            v[row * (w / 2) + col] = (unsigned char)(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+}
+
+// Writes the frame repeat times, converting it once
+void WriteY4mFrame(FILE* file, Image image, int repeat) {
+    static unsigned char planes[SCREEN_WIDTH * SCREEN_HEIGHT * 3 / 2];
+    int w = image.width, h = image.height;
+    if (w * h * 3 / 2 > (int)sizeof(planes)) return;
+    ConvertToY4m(image, planes);
+    for (int r = 0; r < repeat; r++) {
+        fputs("FRAME\n", file);
+        fwrite(planes, 1, w * h * 3 / 2, file);
+    }
+}
+
+void* CaptureEncoderMain(void* unused) {
+    (void)unused;
+    TraceThreadName("capture encoder");
+    FILE* video = NULL;
+    int videoRecording = -1;
+   
+    for (;;) {
+        unsigned int tail = atomic_load_explicit(&captureQueueTail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&captureQueueHead, memory_order_acquire);
+        if (tail == head) {
+            if (!atomic_load_explicit(&captureThreadRunning, memory_order_acquire)) break;
+            if (video != NULL) fflush(video);
+            usleep(2000);
+            continue;
+        }
+       
+        CaptureFrame* frame = &captureQueue[tail & (CAPTURE_QUEUE_FRAMES - 1)];
+        double traceStart = TraceBegin();
+        char fileName[96];
+        if (frame->kind == CAPTURE_Y4M) {
+            if (frame->recording != videoRecording) {
+                if (video != NULL) fclose(video);
+                snprintf(fileName, sizeof(fileName), "capture_%ld_rec%02d.y4m", captureSession, frame->recording);
+                video = fopen(fileName, "wb");
+                videoRecording = frame->recording;
+                if (video != NULL) {
+                    fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", frame->image.width, frame->image.height,
+                            CAPTURE_VIDEO_FPS);
+                }
+            }
+            if (video != NULL) WriteY4mFrame(video, frame->image, frame->repeat);
+        } else {
+            Image upright = ImageCopy(frame->image);  // The queue keeps its buffer; flipping reallocates
+            ImageFlipVertical(&upright);
+            for (int r = 0; r < frame->repeat; r++) {
+                if (frame->kind == CAPTURE_SCREENSHOT) {
+                    snprintf(fileName, sizeof(fileName), "capture_%ld_shot%02d.png", captureSession, frame->recording);
+                } else {
+                    snprintf(fileName, sizeof(fileName), "capture_%ld_rec%02d_%05d.png", captureSession, frame->recording,
+                             frame->sequence + r);
+                }
+                ExportImage(upright, fileName);
+            }
+            UnloadImage(upright);
+        }
+        TraceSpan("EncodeFrame", traceStart, "sequence", frame->sequence);
+        atomic_fetch_add_explicit(&captureWritten, 1, memory_order_relaxed);
+        atomic_store_explicit(&captureQueueTail, tail + 1, memory_order_release);
+    }
+   
+    if (video != NULL) fclose(video);
+    return NULL;
+}
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_MAP_READ_BIT 0x0001
+#define GL_RGBA 0x1908
+#define GL_UNSIGNED_BYTE 0x1401
+#endif
+
+// Pixel-pack buffers let the GPU copy a frame out while the next one is drawn. raylib has loaded
+// the GL entry points already; look them up in the process rather than linking GL ourselves
+int LoadCaptureBuffers() {
+    if (captureBufferState != 0) return captureBufferState > 0;
+    captureBufferState = -1;
+    void* process = dlopen(NULL, RTLD_NOW);
+    if (process == NULL) return 0;
+    captureGenBuffers = (void (*)(int, unsigned int*))dlsym(process, "glGenBuffers");
+    captureDeleteBuffers = (void (*)(int, const unsigned int*))dlsym(process, "glDeleteBuffers");
+    captureBindBuffer = (void (*)(unsigned int, unsigned int))dlsym(process, "glBindBuffer");
+    captureBufferData = (void (*)(unsigned int, ptrdiff_t, const void*, unsigned int))dlsym(process, "glBufferData");
+    captureReadPixels = (void (*)(int, int, int, int, unsigned int, unsigned int, void*))dlsym(process, "glReadPixels");
+    captureMapBufferRange = (void* (*)(unsigned int, ptrdiff_t, ptrdiff_t, unsigned int))dlsym(process, "glMapBufferRange");
+    captureUnmapBuffer = (unsigned char (*)(unsigned int))dlsym(process, "glUnmapBuffer");
+    dlclose(process);  // The GL library stays loaded; raylib links it
+    if (captureGenBuffers == NULL || captureDeleteBuffers == NULL || captureBindBuffer == NULL ||
+        captureBufferData == NULL || captureReadPixels == NULL || captureMapBufferRange == NULL ||
+        captureUnmapBuffer == NULL) {
+        TraceLog(LOG_WARNING, "No pixel-pack buffers, capture reads frames back synchronously");
+        return 0;
+    }
+   
+    captureGenBuffers(2, captureBuffers);
+    for (int i = 0; i < 2; i++) {
+        captureBindBuffer(GL_PIXEL_PACK_BUFFER, captureBuffers[i]);
+        captureBufferData(GL_PIXEL_PACK_BUFFER, SCREEN_WIDTH * SCREEN_HEIGHT * 4, NULL, GL_STREAM_READ);
+    }
+    captureBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    captureBufferState = 1;
+    return 1;
+}
+
+// Issues the copy of a finished target into its buffer; nothing waits on it until the next frame
+void StartCaptureReadback(int target) {
+    if (!LoadCaptureBuffers()) return;
+    rlEnableFramebuffer(captureTargets[target].id);
+    captureBindBuffer(GL_PIXEL_PACK_BUFFER, captureBuffers[target]);
+    captureReadPixels(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    captureBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rlDisableFramebuffer();
+    captureBufferPending[target] = 1;
+}
+
+void QueueCapturedFrame(int target) {
+    int pending = captureBufferPending[target];
+    captureBufferPending[target] = 0;
+    unsigned int head = atomic_load_explicit(&captureQueueHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&captureQueueTail, memory_order_acquire);
+    if (head - tail >= CAPTURE_QUEUE_FRAMES) {
+        captureDropped += captureHeld[target].repeat;  // Encoder is behind; leave the pixels on the GPU
+        return;
+    }
+   
+    if (!captureThreadStarted) {
+        atomic_store(&captureThreadRunning, 1);
+        if (pthread_create(&captureThread, NULL, CaptureEncoderMain, NULL) != 0) {
+            captureDropped += captureHeld[target].repeat;
+            return;
+        }
+        captureThreadStarted = 1;
+    }
+   
+    // Queue entries keep their pixel buffer for the whole run, so a captured frame allocates nothing
+    CaptureFrame* frame = &captureQueue[head & (CAPTURE_QUEUE_FRAMES - 1)];
+    int size = SCREEN_WIDTH * SCREEN_HEIGHT * 4;
+    if (frame->image.data == NULL) {
+        frame->image = (Image){ malloc(size), SCREEN_WIDTH, SCREEN_HEIGHT, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+        if (frame->image.data == NULL) {
+            captureDropped += captureHeld[target].repeat;
+            return;
+        }
+    }
+    if (pending) {
+        captureBindBuffer(GL_PIXEL_PACK_BUFFER, captureBuffers[target]);
+        const void* pixels = captureMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (pixels != NULL) memcpy(frame->image.data, pixels, size);
+        captureUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        captureBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (pixels == NULL) {
+            captureDropped += captureHeld[target].repeat;
+            return;
+        }
+    } else {
+        Image image = LoadImageFromTexture(captureTargets[target].texture);  // Waits on the GPU
+        memcpy(frame->image.data, image.data, size);
+        UnloadImage(image);
+    }
+    frame->kind = captureHeld[target].kind;
+    frame->recording = captureHeld[target].recording;
+    frame->sequence = captureHeld[target].sequence;
+    frame->repeat = captureHeld[target].repeat;
+    atomic_store_explicit(&captureQueueHead, head + 1, memory_order_release);
+}
+
+void StopCaptureThread() {
+    if (captureThreadStarted) {
+        atomic_store_explicit(&captureThreadRunning, 0, memory_order_release);
+        pthread_join(captureThread, NULL);
+        captureThreadStarted = 0;
+    }
+    for (int i = 0; i < CAPTURE_QUEUE_FRAMES; i++) {
+        free(captureQueue[i].image.data);
+        captureQueue[i].image.data = NULL;
+    }
+    if (captureBufferState > 0) {
+        captureDeleteBuffers(2, captureBuffers);
+        captureBufferState = 0;
+    }
+}
+
+#else
+
+void StartCaptureReadback(int target) {
+}
+
+void QueueCapturedFrame(int target) {
+    captureDropped += captureHeld[target].repeat;
+}
+
+void StopCaptureThread() {
+}
+
+#endif
+
+void HandleCaptureInput() {
+    if (IsKeyPressed(KEY_F9)) {
+        captureRecording = !captureRecording;
+        if (captureRecording) {
+            captureRecordingId++;
+            captureSequence = 0;
+            captureRecordStart = GetTime();
+            captureRecordFrames = 0;
+            captureRecordMs = 0;
+            captureReadbackMs = 0;
+        } else if (captureRecordFrames > 0) {
+            TraceLog(LOG_INFO, "Recorded %d frames at %d fps (%d dropped): %.2f ms per frame, %.2f ms before recording, "
+                     "readback %.3f ms per frame", captureSequence, CAPTURE_VIDEO_FPS, captureDropped,
+                     captureRecordMs / captureRecordFrames, captureIdleMs, captureReadbackMs / captureRecordFrames);
+        }
+    }
+    if (IsKeyPressed(KEY_F12)) {
+        captureScreenshot = 1;
+    }
+}
+
+// Replacement for BeginDrawing, routes the frame into a capture target when needed
+void BeginFrame() {
+    if (offlineTarget.id != 0) {
+        BeginTextureMode(offlineTarget);  // Rendering a replay; there is no window to present to
+        return;
+    }
+    BeginDrawing();
+    captureFrameOpen = captureRecording || captureScreenshot || captureHeld[0].kind || captureHeld[1].kind;
+    if (!captureFrameOpen) return;
+   
+    if (captureTargets[0].id == 0) {
+        captureTargets[0] = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+        captureTargets[1] = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    BeginTextureMode(captureTargets[captureIndex]);
+}
+
+void EndFrame() {
+    FlushUiText();
+    if (offlineTarget.id != 0) {
+        EndTextureMode();
+        return;
+    }
+    float frameMs = GetFrameTime() * 1000.0f;
+    if (captureRecording) {
+        captureRecordFrames++;
+        captureRecordMs += frameMs;
+    } else {
+        captureIdleMs = captureIdleMs > 0 ? captureIdleMs * 0.95f + frameMs * 0.05f : frameMs;
+    }
+    if (captureFrameOpen) {
+        EndTextureMode();
+        double readbackStart = GetTime();
+       
+        // Remember what this frame is for; its pixels are collected one frame from now
+        CaptureHeld* held = &captureHeld[captureIndex];
+        held->kind = CAPTURE_NONE;
+        held->repeat = 1;
+        if (captureScreenshot) {
+            held->kind = CAPTURE_SCREENSHOT;
+            held->recording = ++captureShots;
+            captureScreenshot = 0;
+        } else if (captureRecording) {
+            // Output frames follow the recording clock: a late frame is repeated, an early one skipped
+            int due = (int)((GetTime() - captureRecordStart) * CAPTURE_VIDEO_FPS) + 1 - captureSequence;
+            if (due > 0) {
+                held->kind = captureFormat;
+                held->recording = captureRecordingId;
+                held->sequence = captureSequence;
+                held->repeat = due < CAPTURE_VIDEO_FPS ? due : CAPTURE_VIDEO_FPS;
+                captureSequence += held->repeat;
+            }
+        }
+        if (held->kind != CAPTURE_NONE) {
+            StartCaptureReadback(captureIndex);
+        }
+       
+        int previous = 1 - captureIndex;
+        if (captureHeld[previous].kind != CAPTURE_NONE) {
+            QueueCapturedFrame(previous);
+            captureHeld[previous].kind = CAPTURE_NONE;
+        }
+        if (captureRecording) {
+            captureReadbackMs += (GetTime() - readbackStart) * 1000.0;
+        }
+        DrawTextureRec(captureTargets[captureIndex].texture,
+                       (Rectangle){ 0, 0, SCREEN_WIDTH, -SCREEN_HEIGHT }, (Vector2){ 0, 0 }, WHITE);
+        captureIndex = previous;
+       
+        // Drawn on the screen only, never into the capture
+        if (captureRecording) {
+            char recText[96];
+            sprintf(recText, "REC %.1fs  dropped %d  readback %.2f ms", GetTime() - captureRecordStart, captureDropped,
+                    captureRecordFrames > 0 ? captureReadbackMs / captureRecordFrames : 0.0);
+            DrawCircle(16, SCREEN_HEIGHT - 16, 6, RED);
+            DrawUiText(recText, 28, SCREEN_HEIGHT - 24, 16, RED);
+            FlushUiText();
+        }
+    }
+    double presentStart = TraceBegin();
+    EndDrawing();
+    TraceSpan("Present", presentStart, NULL, 0);
+}
+
+void UnloadCapture() {
+    StopCaptureThread();
+    if (captureTargets[0].id != 0) {
+        UnloadRenderTexture(captureTargets[0]);
+        UnloadRenderTexture(captureTargets[1]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Shader board: the single-player board lives in a tiny cell-state texture
+// (one texel per cell) and one fragment shader turns it into the full board,
+// so draw cost no longer depends on snake length or board contents. The
+// simulation reports the cells it changes and only those texels are
+// recomputed and uploaded, so the CPU side scales with events rather than
+// the snake; bulk changes rebuild the texture once. Falls back to the
+// immediate-mode drawing when the shader does not compile.
+// ---------------------------------------------------------------------------
+
+// Texel layout: r = kind, g/b = body stamp (move number the segment was laid), a = phantom wall
+const char* boardShaderCode =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "out vec4 finalColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec2 boardSize;\n"
+    "uniform float cellPixels;\n"
+    "uniform float headStamp;\n"
+    "uniform float snakeLength;\n"
+    "uniform vec3 snakeColor;\n"
+    "uniform vec2 headDir;\n"
+    "uniform float emptyAlpha;\n"
+    "float RoundedBox(vec2 p, vec2 halfSize, float radius) {\n"
+    "    vec2 q = abs(p) - halfSize + radius;\n"
+    "    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;\n"
+    "}\n"
+    "float Ellipse(vec2 p, vec2 radii) {\n"
+    "    return (length(p / radii) - 1.0) * min(radii.x, radii.y);\n"
+    "}\n"
+    "void main() {\n"
+    "    vec2 pos = fragTexCoord * boardSize;\n"
+    "    vec2 cell = floor(pos);\n"
+    "    vec2 local = pos - cell - 0.5;\n"
+    "    vec4 state = texelFetch(texture0, ivec2(cell), 0) * 255.0;\n"
+    "    float aa = 1.0 / cellPixels;\n"
+    "    vec3 color = vec3(0.0);\n"
+    "    if (pos.x - cell.x < aa || pos.y - cell.y < aa) color = vec3(70.0 / 255.0 * 120.0 / 255.0);\n"
+    "    int kind = int(state.r + 0.5);\n"
+    "    if (kind == 1 || kind == 2) {\n"
+    "        float index = mod(headStamp - (state.g + state.b * 256.0), 65536.0);\n"
+    "        vec3 body = snakeColor * (1.0 - index / snakeLength * vec3(0.5, 0.3, 0.1));\n"
+    "        float d = RoundedBox(local, vec2(0.5), kind == 2 ? 0.25 : 0.15);\n"
+    "        color = mix(color, body, clamp(0.5 - d / aa, 0.0, 1.0));\n"
+    "        if (kind == 2) {\n"
+    "            vec2 side = vec2(-headDir.y, headDir.x);\n"
+    "            for (int e = -1; e <= 1; e += 2) {\n"
+    "                float eye = RoundedBox(local - headDir * 0.3 - side * 0.15 * float(e), vec2(0.1), 0.08);\n"
+    "                color = mix(color, vec3(1.0), clamp(0.5 - eye / aa, 0.0, 1.0));\n"
+    "            }\n"
+    "        }\n"
+    "    } else if (kind == 3) {\n"
+    "        color = mix(color, vec3(200.0, 0.0, 0.0) / 255.0, clamp(0.5 - (length(local) - 0.4) / aa, 0.0, 1.0));\n"
+    "        if (abs(local.x) < 0.05 && local.y > -0.4 && local.y < -0.2) color = vec3(101.0, 67.0, 33.0) / 255.0;\n"
+    "        color = mix(color, vec3(34.0, 139.0, 34.0) / 255.0, clamp(0.5 - Ellipse(local - vec2(0.1, -0.4), vec2(0.2, 0.1)) / aa, 0.0, 1.0));\n"
+    "    } else if (kind == 4) {\n"
+    "        color = mix(color, vec3(1.0, 165.0 / 255.0, 0.0), clamp(0.5 - RoundedBox(local, vec2(0.4), 0.36) / aa, 0.0, 1.0));\n"
+    "        float stem = RoundedBox(local - vec2(0.0, -0.42), vec2(0.08, 0.12), 0.06);\n"
+    "        color = mix(color, vec3(139.0, 69.0, 19.0) / 255.0, clamp(0.5 - stem / aa, 0.0, 1.0));\n"
+    "    }\n"
+    "    if (state.a > 127.5) color = vec3(1.0, 100.0 / 255.0, 100.0 / 255.0);\n"
+    "    finalColor = vec4(color, kind == 0 && state.a < 127.5 ? emptyAlpha : 1.0);\n"
+    "}\n";
+
+void InitBoardRenderer() {
+    boardShader = LoadShaderFromMemory(NULL, boardShaderCode);
+    if (boardShader.id == 0 || boardShader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "Board shader unavailable, drawing the board on the CPU");
+        return;
+    }
+   
+    Image image = GenImageColor(BOARD_COLS, BOARD_ROWS, BLANK);
+    boardTexture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(boardTexture, TEXTURE_FILTER_POINT);
+    memset(boardTexels, 0, sizeof(boardTexels));
+   
+    boardHeadStampLoc = GetShaderLocation(boardShader, "headStamp");
+    boardLengthLoc = GetShaderLocation(boardShader, "snakeLength");
+    boardColorLoc = GetShaderLocation(boardShader, "snakeColor");
+    boardDirLoc = GetShaderLocation(boardShader, "headDir");
+    boardEmptyAlphaLoc = GetShaderLocation(boardShader, "emptyAlpha");
+    Vector2 size = { BOARD_COLS, BOARD_ROWS };
+    float cellPixels = GRID_SIZE;
+    SetShaderValue(boardShader, GetShaderLocation(boardShader, "boardSize"), &size, SHADER_UNIFORM_VEC2);
+    SetShaderValue(boardShader, GetShaderLocation(boardShader, "cellPixels"), &cellPixels, SHADER_UNIFORM_FLOAT);
+    boardShaderReady = 1;
+}
+
+void UnloadBoardRenderer() {
+    if (!boardShaderReady) return;
+    UnloadTexture(boardTexture);
+    UnloadShader(boardShader);
+    boardShaderReady = 0;
+}
+
+// Rebuilds every cell state and uploads the row spans that differ; only after bulk changes
+void RebuildBoardTexels() {
+    static unsigned char next[BOARD_CELLS][4];
+    memset(next, 0, sizeof(next));
+   
+    for (int w = 0; w < entities.wallCount; w++) {
+        for (int i = 0; i < entities.wallCellCount[w]; i++) {
+            next[entities.wallCells[w][i]][3] = 255;
+        }
+    }
+    for (int p = 0; p < entities.pickupCount; p++) {
+        // Golden fruit blinks during its last two seconds
+        if (entities.pickupKind[p] == PICKUP_GOLDEN &&
+            entities.pickupLife[p] < 2.0f && fmodf(entities.pickupLife[p], 0.4f) < 0.2f) continue;
+        next[entities.pickupCell[p]][0] = entities.pickupKind[p] == PICKUP_GOLDEN ? 4 : 3;
+    }
+    for (int i = snake.length - 1; i >= 0; i--) {
+        unsigned int stamp = (snake.headSeq - i) & 0xFFFF;
+        unsigned char* texel = next[SnakeCell(i)];
+        texel[0] = i == 0 ? 2 : 1;
+        texel[1] = stamp & 0xFF;
+        texel[2] = stamp >> 8;
+    }
+   
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        int first = -1, last = -1;
+        for (int col = 0; col < BOARD_COLS; col++) {
+            int cell = row * BOARD_COLS + col;
+            if (memcmp(next[cell], boardTexels[cell], 4) != 0) {
+                if (first < 0) first = col;
+                last = col;
+            }
+        }
+        if (first < 0) continue;
+       
+        int cell = row * BOARD_COLS + first;
+        memcpy(boardTexels[cell], next[cell], (last - first + 1) * 4);
+        UpdateTextureRec(boardTexture, (Rectangle){ first, row, last - first + 1, 1 }, boardTexels[cell]);
+    }
+}
+
+// Recomputes one cell from the simulation's per-cell lookups; returns 0 if a segment's stamp can't be known
+int RefreshBoardTexel(Cell cell) {
+    unsigned char texel[4] = { 0, 0, 0, 0 };
+    int levelWall = levelWalls != NULL && currentMode == MAZE ? levelWalls[cell] : 0;
+    if (entities.wallsAt[cell] > levelWall) texel[3] = 255;  // Maze walls are in the background, not the texture
+   
+    int slot = entities.pickupAt[cell] - 1;
+    if (slot >= 0 && !(entities.pickupKind[slot] == PICKUP_GOLDEN && entities.pickupLife[slot] < 2.0f &&
+                       fmodf(entities.pickupLife[slot], 0.4f) < 0.2f)) {
+        texel[0] = entities.pickupKind[slot] == PICKUP_GOLDEN ? 4 : 3;
+    }
+   
+    // Segments keep the stamp they were laid with; only the head and tail can be new to a cell
+    if (snake.bodyAt[cell] > 0) {
+        unsigned int stamp;
+        if (cell == SnakeCell(0)) {
+            stamp = snake.headSeq;
+        } else if (boardTexels[cell][0] == 1 || boardTexels[cell][0] == 2) {
+            stamp = boardTexels[cell][1] | boardTexels[cell][2] << 8;
+        } else if (cell == SnakeCell(snake.length - 1)) {
+            stamp = snake.headSeq - snake.length + 1;
+        } else {
+            return 0;
+        }
+        texel[0] = cell == SnakeCell(0) ? 2 : 1;
+        texel[1] = stamp & 0xFF;
+        texel[2] = (stamp >> 8) & 0xFF;
+    }
+   
+    if (memcmp(texel, boardTexels[cell], 4) != 0) {
+        memcpy(boardTexels[cell], texel, 4);
+        UpdateTextureRec(boardTexture, (Rectangle){ cell % BOARD_COLS, cell / BOARD_COLS, 1, 1 }, boardTexels[cell]);
+    }
+    return 1;
+}
+
+// Uploads only the cells the simulation reported changed, so the cost follows events, not snake length
+void UploadBoardTexels() {
+    // Over more than one move a cell can be left and re-entered unseen, so only single moves are incremental
+    int moves = (int)(snake.headSeq - boardLastSeq);
+    int consistent = boardChangeCount <= BOARD_CHANGES_MAX && moves >= -1 && moves <= 1;
+    for (int i = 0; consistent && i < boardChangeCount; i++) {
+        consistent = RefreshBoardTexel(boardChanges[i]);
+    }
+   
+    // The old head turns into body, and golden fruit blinks without any event
+    Cell head = SnakeCell(0);
+    if (consistent && head != boardLastHead) consistent = RefreshBoardTexel(boardLastHead) && RefreshBoardTexel(head);
+    for (int p = 0; consistent && p < entities.pickupCount; p++) {
+        if (entities.pickupKind[p] == PICKUP_GOLDEN) consistent = RefreshBoardTexel(entities.pickupCell[p]);
+    }
+   
+    if (!consistent) RebuildBoardTexels();
+    boardChangeCount = 0;
+    boardLastHead = head;
+    boardLastSeq = snake.headSeq;
+}
+
+void DrawBoardShader() {
+    UploadBoardTexels();
+   
+    Color c = SnakeSegmentColor(0);
+    Vector3 color = { c.r / 255.0f, c.g / 255.0f, c.b / 255.0f };
+    Vector2 dir = { snake.dx, snake.dy };
+    float headStamp = snake.headSeq & 0xFFFF;
+    float length = snake.length;
+    float emptyAlpha = DrawLevelBackground() ? 0.0f : 1.0f;  // Empty cells let the maze background through
+    SetShaderValue(boardShader, boardHeadStampLoc, &headStamp, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(boardShader, boardLengthLoc, &length, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(boardShader, boardColorLoc, &color, SHADER_UNIFORM_VEC3);
+    SetShaderValue(boardShader, boardDirLoc, &dir, SHADER_UNIFORM_VEC2);
+    SetShaderValue(boardShader, boardEmptyAlphaLoc, &emptyAlpha, SHADER_UNIFORM_FLOAT);
+   
+    BeginShaderMode(boardShader);
+    DrawTexturePro(
+        boardTexture,
+        (Rectangle){ 0, 0, BOARD_COLS, BOARD_ROWS },
+        (Rectangle){ 0, NAV_BAR_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT - NAV_BAR_HEIGHT },
+        (Vector2){ 0, 0 },
+        0,
+        WHITE
+    );
+    EndShaderMode();
+}
+
+void RenderFrontPage() {
+    BeginFrame();
+    ClearBackground(bgColor);
+
+    // SNAKESCAPE title with glow effect
+    const char* gameTitle = "SNAKESCAPE";
+    int titleSize = 70;
+    int titleY = 120;
+    
+    // Glow effect for title
+    for (int i = 5; i > 0; i--) {
+        Color glowColor = accentColor1;
+        glowColor.a = 30 + 10 * i;
+        DrawUiText(gameTitle, 
+                 SCREEN_WIDTH / 2 - MeasureUiText(gameTitle, titleSize) / 2 + i/2, 
+                 titleY - i/2, 
+                 titleSize, 
+                 glowColor);
+        DrawUiText(gameTitle, 
+                 SCREEN_WIDTH / 2 - MeasureUiText(gameTitle, titleSize) / 2 - i/2, 
+                 titleY - i/2, 
+                 titleSize, 
+                 glowColor);
+    }
+    
+    // Main title
+    DrawUiText(gameTitle,
+             SCREEN_WIDTH / 2 - MeasureUiText(gameTitle, titleSize) / 2,
+             titleY,
+             titleSize,
+             accentColor1);
+
+    // Subtitle "Hunt. Grow. Survive." with color gradient
+    const char* subtitle = "Hunt. Grow. Survive.";
+    int subtitleSize = 30;
+    int subtitleY = titleY + 80;
+    
+    // Glow effect for subtitle
+    for (int i = 3; i > 0; i--) {
+        Color glowColor = accentColor2;
+        glowColor.a = 40;
+        DrawUiText(subtitle,
+                 SCREEN_WIDTH / 2 - MeasureUiText(subtitle, subtitleSize) / 2 + i/2,
+                 subtitleY - i/2,
+                 subtitleSize,
+                 glowColor);
+    }
+    
+    // Main subtitle
+    DrawUiText(subtitle,
+             SCREEN_WIDTH / 2 - MeasureUiText(subtitle, subtitleSize) / 2,
+             subtitleY,
+             subtitleSize,
+             accentColor2);
+
+    // Update button positions to be at bottom, side by side
+    int buttonWidth = 180;
+    int buttonHeight = 45;
+    int buttonSpacing = 20; // Space between buttons
+    
+    startButton.rect.x = SCREEN_WIDTH/2 - buttonWidth - buttonSpacing/2;
     startButton.rect.y = SCREEN_HEIGHT - 120;
     startButton.rect.width = buttonWidth;
     startButton.rect.height = buttonHeight;
@@ -593,9 +5979,9 @@ void RenderFrontPage() {
         startButton.hover ? WHITE : (Color){ 200, 200, 200, 255 }
     );
     
-    DrawText(
+    DrawUiText(
         startButton.text,
-        startButton.rect.x + startButton.rect.width/2 - MeasureText(startButton.text, 22)/2,
+        startButton.rect.x + startButton.rect.width/2 - MeasureUiText(startButton.text, 22)/2,
         startButton.rect.y + startButton.rect.height/2 - 11,
         22,
         startButton.textColor
@@ -623,9 +6009,9 @@ void RenderFrontPage() {
         exitButton.hover ? WHITE : (Color){ 200, 200, 200, 255 }
     );
     
-    DrawText(
+    DrawUiText(
         exitButton.text,
-        exitButton.rect.x + exitButton.rect.width/2 - MeasureText(exitButton.text, 22)/2,
+        exitButton.rect.x + exitButton.rect.width/2 - MeasureUiText(exitButton.text, 22)/2,
         exitButton.rect.y + exitButton.rect.height/2 - 11,
         22,
         exitButton.textColor
@@ -633,17 +6019,17 @@ void RenderFrontPage() {
 
     // Display keyboard shortcuts at bottom (below buttons)
     const char* msg = "or use ENTER / ESC keys";
-    DrawText(msg,
-             SCREEN_WIDTH / 2 - MeasureText(msg, 16) / 2,
+    DrawUiText(msg,
+             SCREEN_WIDTH / 2 - MeasureUiText(msg, 16) / 2,
              SCREEN_HEIGHT - 55,
              16,
              (Color){150, 150, 150, 255});
 
-    EndDrawing();
+    EndFrame();
 }
 
 void RenderMenu() {
-    BeginDrawing();
+    BeginFrame();
 
     // Solid background with subtle gradient
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
@@ -665,12 +6051,12 @@ void RenderMenu() {
     for (int i = 3; i > 0; i--) {
         Color glowColor = accentColor1;
         glowColor.a = 20 + 10 * i;
-        DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2 + i/2, 100 - i/2, titleSize, glowColor);
-        DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2 - i/2, 100 - i/2, titleSize, glowColor);
+        DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2 + i/2, 100 - i/2, titleSize, glowColor);
+        DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2 - i/2, 100 - i/2, titleSize, glowColor);
     }
    
     // Main title
-    DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2, 100, titleSize, accentColor1);
+    DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2, 100, titleSize, accentColor1);
    
     // Menu buttons
     for (int i = 0; i < numOptions; i++) {
@@ -696,9 +6082,9 @@ void RenderMenu() {
         );
        
         // Button text
-        DrawText(
+        DrawUiText(
             menuButtons[i].text,
-            menuButtons[i].rect.x + menuButtons[i].rect.width/2 - MeasureText(menuButtons[i].text, 25)/2,
+            menuButtons[i].rect.x + menuButtons[i].rect.width/2 - MeasureUiText(menuButtons[i].text, 25)/2,
             menuButtons[i].rect.y + menuButtons[i].rect.height/2 - 12,
             25,
             menuButtons[i].textColor
@@ -719,35 +6105,43 @@ void RenderMenu() {
         }
     }
  
-    DrawText("Click on a mode to start playing",
-        SCREEN_WIDTH/2 - MeasureText("Click on a mode to start playing", 20)/2,
+    DrawUiText("Click on a mode to start playing",
+        SCREEN_WIDTH/2 - MeasureUiText("Click on a mode to start playing", 20)/2,
         SCREEN_HEIGHT - 70, 20, accentColor3);
    
     // Game mode descriptions
     int descY = SCREEN_HEIGHT - 40;
     if (selectedOption == 0) {
-        DrawText("Classic: The traditional snake game experience",
-            SCREEN_WIDTH/2 - MeasureText("Classic: The traditional snake game experience", 20)/2,
+        DrawUiText("Classic: The traditional snake game experience",
+            SCREEN_WIDTH/2 - MeasureUiText("Classic: The traditional snake game experience", 20)/2,
             descY, 20, accentColor1);
     } else if (selectedOption == 1) {
-        DrawText("Time Attack: Score as much as possible before time runs out",
-            SCREEN_WIDTH/2 - MeasureText("Time Attack: Score as much as possible before time runs out", 20)/2,
+        DrawUiText("Time Attack: Score as much as possible before time runs out",
+            SCREEN_WIDTH/2 - MeasureUiText("Time Attack: Score as much as possible before time runs out", 20)/2,
             descY, 20, accentColor2);
     } else if (selectedOption == 2) {
-        DrawText("Challenge: Dodge phantom walls and collect golden fruit!",
-            SCREEN_WIDTH/2 - MeasureText("Challenge: Dodge phantom walls and collect golden fruit!", 20)/2,
+        DrawUiText("Challenge: Dodge phantom walls and collect golden fruit!",
+            SCREEN_WIDTH/2 - MeasureUiText("Challenge: Dodge phantom walls and collect golden fruit!", 20)/2,
             descY, 20, accentColor3);
     } else if (selectedOption == 3) {
-        DrawText("Infinite: Snake can't die - play as long as you want!",
-            SCREEN_WIDTH/2 - MeasureText("Infinite: Snake can't die - play as long as you want!", 20)/2,
+        DrawUiText("Infinite: Snake can't die - play as long as you want!",
+            SCREEN_WIDTH/2 - MeasureUiText("Infinite: Snake can't die - play as long as you want!", 20)/2,
             descY, 20, (Color){200, 200, 0, 255});
+    } else if (selectedOption == 4) {
+        DrawUiText("Maze: Find your way to the fruit through fixed walls",
+            SCREEN_WIDTH/2 - MeasureUiText("Maze: Find your way to the fruit through fixed walls", 20)/2,
+            descY, 20, (Color){255, 170, 120, 255});
+    } else if (selectedOption == 5) {
+        DrawUiText("Arena: Outgrow 256 AI snakes on a giant shared board",
+            SCREEN_WIDTH/2 - MeasureUiText("Arena: Outgrow 256 AI snakes on a giant shared board", 20)/2,
+            descY, 20, (Color){215, 160, 235, 255});
     }
     
-    EndDrawing();
+    EndFrame();
 }
 
 void RenderCountdown() {
-    BeginDrawing();
+    BeginFrame();
    
     // Solid background
     ClearBackground(bgColor);
@@ -782,9 +6176,9 @@ void RenderCountdown() {
     for (int i = 3; i > 0; i--) {
         Color glowColor = countdownColor;
         glowColor.a = 50;
-        DrawText(
+        DrawUiText(
             countdownText,
-            SCREEN_WIDTH/2 - MeasureText(countdownText, fontSize)/2 + i,
+            SCREEN_WIDTH/2 - MeasureUiText(countdownText, fontSize)/2 + i,
             SCREEN_HEIGHT/2 - fontSize/2,
             fontSize,
             glowColor
@@ -792,9 +6186,9 @@ void RenderCountdown() {
     }
    
     // Main text
-    DrawText(
+    DrawUiText(
         countdownText,
-        SCREEN_WIDTH/2 - MeasureText(countdownText, fontSize)/2,
+        SCREEN_WIDTH/2 - MeasureUiText(countdownText, fontSize)/2,
         SCREEN_HEIGHT/2 - fontSize/2,
         fontSize,
         countdownColor
@@ -821,56 +6215,546 @@ void RenderCountdown() {
             modeText = "INFINITE PLAY";
             modeColor = (Color){200, 200, 0, 255};
             break;
+        case MAZE:
+            modeText = "MAZE MODE";
+            modeColor = (Color){255, 170, 120, 255};
+            break;
+        case ARENA:
+            modeText = "SNAKE ARENA";
+            modeColor = (Color){215, 160, 235, 255};
+            break;
+        case VERSUS:
+            modeText = "VERSUS";
+            modeColor = phantomWallColor;
+            break;
+    }
+   
+    DrawUiText(
+        modeText,
+        SCREEN_WIDTH/2 - MeasureUiText(modeText, 30)/2,
+        SCREEN_HEIGHT/2 + 100,
+        30,
+        modeColor
+    );
+   
+    // Get ready message
+    DrawUiText(
+        "Get Ready!",
+        SCREEN_WIDTH/2 - MeasureUiText("Get Ready!", 40)/2,
+        SCREEN_HEIGHT/2 - 150,
+        40,
+        WHITE
+    );
+   
+    EndFrame();
+}
+
+// Follow camera for one snake onto the shared board; only the cells inside the view are visited
+void DrawArenaView(int id, int slot, int left, int top, int width, int height, int predicted) {
+    ArenaSnake* player = &arena.snakes[id];
+    const int viewCols = width / ARENA_CELL_PIXELS;
+    const int viewRows = height / ARENA_CELL_PIXELS;
+    static int viewX[COOP_MAX_PLAYERS];
+    static int viewY[COOP_MAX_PLAYERS];
+    static int viewPlaced[COOP_MAX_PLAYERS];
+    if (player->alive) {
+        unsigned int head = predicted > 0 ? netSession.predictedCells[predicted - 1] : ArenaSnakeCell(player, 0);
+        viewX[slot] = (int)(head % ARENA_WIDTH) - viewCols / 2;
+        viewY[slot] = (int)(head / ARENA_WIDTH) - viewRows / 2;
+        viewPlaced[slot] = 1;
+    } else if (!viewPlaced[slot]) {
+        viewX[slot] = (ARENA_WIDTH - viewCols) / 2;
+        viewY[slot] = (ARENA_HEIGHT - viewRows) / 2;
+    }
+    int originX = viewX[slot];
+    int originY = viewY[slot];
+   
+    // Board outline, cut to the view so split screens do not draw into each other
+    Rectangle view = { left, top, viewCols * ARENA_CELL_PIXELS, viewRows * ARENA_CELL_PIXELS };
+    float boardX = left - originX * ARENA_CELL_PIXELS - 2;
+    float boardY = top - originY * ARENA_CELL_PIXELS - 2;
+    float boardWidth = ARENA_WIDTH * ARENA_CELL_PIXELS + 4;
+    float boardHeight = ARENA_HEIGHT * ARENA_CELL_PIXELS + 4;
+    Rectangle edges[4] = {
+        { boardX, boardY, boardWidth, 2 },
+        { boardX, boardY + boardHeight - 2, boardWidth, 2 },
+        { boardX, boardY, 2, boardHeight },
+        { boardX + boardWidth - 2, boardY, 2, boardHeight }
+    };
+    for (int i = 0; i < 4; i++) {
+        Rectangle visible = GetCollisionRec(view, edges[i]);
+        if (visible.width > 0 && visible.height > 0) {
+            DrawRectangleRec(visible, phantomWallColor);
+        }
+    }
+   
+    Color foodColor = (Color){ 200, 0, 0, 255 };
+    for (int row = 0; row < viewRows; row++) {
+        int y = originY + row;
+        if (y < 0 || y >= ARENA_HEIGHT) continue;
+        for (int col = 0; col < viewCols; col++) {
+            int x = originX + col;
+            if (x < 0 || x >= ARENA_WIDTH) continue;
+           
+            unsigned short v = arena.grid[y * ARENA_WIDTH + x];
+            if (v == ARENA_CELL_EMPTY) continue;
+           
+            int px = left + col * ARENA_CELL_PIXELS;
+            int py = top + row * ARENA_CELL_PIXELS;
+            if (v >= ARENA_CELL_FOOD) {
+                DrawCircle(px + ARENA_CELL_PIXELS / 2, py + ARENA_CELL_PIXELS / 2, ARENA_CELL_PIXELS / 2 - 1, foodColor);
+                continue;
+            }
+           
+            int owner = v - 1;
+            int cell = y * ARENA_WIDTH + x;
+            if (owner == id && predicted > 0 && IsRetractedCell(cell)) {
+                continue;  // Our predicted moves have already left this tail cell
+            }
+            if (ArenaSnakeCell(&arena.snakes[owner], 0) == (unsigned int)cell && !(owner == id && predicted > 0)) {
+                DrawRectangleRounded(
+                    (Rectangle){ px, py, ARENA_CELL_PIXELS, ARENA_CELL_PIXELS },
+                    0.5f,
+                    4,
+                    owner == id ? WHITE : arenaColors[owner]
+                );
+            } else {
+                DrawRectangle(px + 1, py + 1, ARENA_CELL_PIXELS - 2, ARENA_CELL_PIXELS - 2, arenaColors[owner]);
+            }
+        }
+    }
+   
+    // Predicted moves for a networked player, drawn over the last snapshot
+    for (int i = 0; i < predicted; i++) {
+        int x = (int)(netSession.predictedCells[i] % ARENA_WIDTH) - originX;
+        int y = (int)(netSession.predictedCells[i] / ARENA_WIDTH) - originY;
+        if (x < 0 || x >= viewCols || y < 0 || y >= viewRows) continue;
+        if (i < predicted - 1 && IsRetractedCell(netSession.predictedCells[i])) continue;
+        int px = left + x * ARENA_CELL_PIXELS;
+        int py = top + y * ARENA_CELL_PIXELS;
+        if (i == predicted - 1) {
+            DrawRectangleRounded((Rectangle){ px, py, ARENA_CELL_PIXELS, ARENA_CELL_PIXELS }, 0.5f, 4, WHITE);
+        } else {
+            DrawRectangle(px + 1, py + 1, ARENA_CELL_PIXELS - 2, ARENA_CELL_PIXELS - 2, arenaColors[id]);
+        }
+    }
+}
+
+void RenderArena() {
+    BeginFrame();
+    ClearBackground(bgColor);
+   
+    ArenaSnake* player = &arena.snakes[arenaPlayer];
+    if (coopPlayers > 0) {
+        // Split screen: side by side for two players, quadrants for three or four
+        int columns = coopPlayers > 1 ? 2 : 1;
+        int rows = coopPlayers > 2 ? 2 : 1;
+        int slotWidth = SCREEN_WIDTH / columns;
+        int slotHeight = (SCREEN_HEIGHT - NAV_BAR_HEIGHT) / rows;
+        int width = (slotWidth - 4) / ARENA_CELL_PIXELS * ARENA_CELL_PIXELS;
+        int height = (slotHeight - 4) / ARENA_CELL_PIXELS * ARENA_CELL_PIXELS;
+        for (int p = 0; p < coopPlayers; p++) {
+            int left = (p % columns) * slotWidth + (slotWidth - width) / 2;
+            int top = NAV_BAR_HEIGHT + (p / columns) * slotHeight + (slotHeight - height) / 2;
+            DrawArenaView(p, p, left, top, width, height, 0);
+            DrawRectangleLines(left - 1, top - 1, width + 2, height + 2, arenaColors[p]);
+            if (!arena.snakes[p].alive) {
+                DrawUiText("RESPAWNING...", left + width/2 - MeasureUiText("RESPAWNING...", 30)/2,
+                        top + height/2 - 15, 30, phantomWallColor);
+            }
+        }
+    } else {
+        DrawArenaView(arenaPlayer, 0, 0, NAV_BAR_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT - NAV_BAR_HEIGHT,
+                      player->alive ? netSession.predictedCount : 0);
+    }
+   
+    // Minimap with every live head, the local ones marked larger
+    const int mapSize = 128;
+    const int mapX = SCREEN_WIDTH - mapSize - 10;
+    const int mapY = SCREEN_HEIGHT - mapSize - 10;
+    DrawRectangle(mapX, mapY, mapSize, mapSize, (Color){ 15, 15, 20, 220 });
+    DrawRectangleLines(mapX, mapY, mapSize, mapSize, (Color){ 70, 70, 70, 255 });
+    for (int id = 0; id < ARENA_MAX_SNAKES; id++) {
+        ArenaSnake* s = &arena.snakes[id];
+        if (!s->alive || id == arenaPlayer || id < coopPlayers) continue;
+        unsigned int head = ArenaSnakeCell(s, 0);
+        DrawRectangle(mapX + (head % ARENA_WIDTH) * mapSize / ARENA_WIDTH - 1,
+                      mapY + (head / ARENA_WIDTH) * mapSize / ARENA_HEIGHT - 1,
+                      2, 2, arenaColors[id]);
+    }
+    int localCount = coopPlayers > 0 ? coopPlayers : 1;
+    for (int i = 0; i < localCount; i++) {
+        int id = coopPlayers > 0 ? i : arenaPlayer;
+        ArenaSnake* s = &arena.snakes[id];
+        if (!s->alive) continue;
+        unsigned int head = ArenaSnakeCell(s, 0);
+        DrawRectangle(mapX + (head % ARENA_WIDTH) * mapSize / ARENA_WIDTH - 2,
+                      mapY + (head / ARENA_WIDTH) * mapSize / ARENA_HEIGHT - 2,
+                      4, 4, coopPlayers > 0 ? arenaColors[id] : WHITE);
+    }
+   
+    // Navigation bar
+    DrawRectangle(0, 0, SCREEN_WIDTH, NAV_BAR_HEIGHT, navBarColor);
+   
+    if (coopPlayers > 0) {
+        int x = 20;
+        for (int p = 0; p < coopPlayers; p++) {
+            char lengthText[24];
+            sprintf(lengthText, "P%d: %d", p + 1, arena.snakes[p].alive ? arena.snakes[p].length : 0);
+            DrawUiText(lengthText, x, 20, 24, arenaColors[p]);
+            x += MeasureUiText(lengthText, 24) + 16;
+        }
+    } else {
+        char scoreText[60];
+        sprintf(scoreText, "Length: %d  Kills: %d", player->alive ? player->length : 0,
+                netSession.active ? netSession.kills : player->kills);
+        DrawUiText(scoreText, 20, 20, 24, WHITE);
+        DrawUiText("SNAKE ARENA", SCREEN_WIDTH/2 - MeasureUiText("SNAKE ARENA", 24)/2, 20, 24, (Color){215, 160, 235, 255});
+    }
+   
+    char statsText[80];
+    if (netSession.active) {
+        sprintf(statsText, "Alive: %d/%d  Net: %.1f KB/s  Corrections: %d", arena.aliveCount, ARENA_MAX_SNAKES,
+                netSession.kilobytesPerSecond, netSession.corrections);
+    } else if (coopPlayers > 0) {
+        sprintf(statsText, "Alive: %d/%d  Input: %.0f Hz", arena.aliveCount, ARENA_MAX_SNAKES, inputRate);
+    } else {
+        sprintf(statsText, "Alive: %d/%d  Tick: %.2f ms", arena.aliveCount, ARENA_MAX_SNAKES, arena.tickMs);
+    }
+    DrawUiText(statsText, SCREEN_WIDTH - MeasureUiText(statsText, 18) - 20, 22, 18, accentColor2);
+   
+    if (coopPlayers > 0) {
+        DrawUiText("P1: WASD | P2: Arrows | P3: IJKL | P4: Numpad | Gamepads in order | P: Pause | Q: Menu",
+                20, 50, 16, (Color){180, 180, 180, 200});
+    } else {
+        DrawUiText("P: Pause | Q: Menu | ESC: Quit Game", 20, 50, 16, (Color){180, 180, 180, 200});
+    }
+   
+    if (netSession.active && netSession.tick == 0) {
+        DrawUiText("CONNECTING...", SCREEN_WIDTH/2 - MeasureUiText("CONNECTING...", 40)/2,
+                SCREEN_HEIGHT/2 - 20, 40, accentColor2);
+    } else if (!player->alive && coopPlayers == 0) {
+        DrawUiText("RESPAWNING...", SCREEN_WIDTH/2 - MeasureUiText("RESPAWNING...", 40)/2,
+                SCREEN_HEIGHT/2 - 20, 40, phantomWallColor);
+    }
+   
+    if (paused) {
+        DrawUiText("PAUSED", SCREEN_WIDTH/2 - MeasureUiText("PAUSED", 40)/2,
+                SCREEN_HEIGHT/2 - 20, 40, WHITE);
+        DrawUiText("Press P to resume", SCREEN_WIDTH/2 - MeasureUiText("Press P to resume", 20)/2,
+                SCREEN_HEIGHT/2 + 30, 20, accentColor3);
+    }
+   
+    EndFrame();
+}
+
+void RenderVersus() {
+    BeginFrame();
+    ClearBackground(bgColor);
+   
+    // Grid lines, as in the classic board
+    for (int i = 0; i < SCREEN_WIDTH/GRID_SIZE; i++) {
+        DrawLine(i * GRID_SIZE, NAV_BAR_HEIGHT, i * GRID_SIZE, SCREEN_HEIGHT,
+                 (Color){70, 70, 70, 120});
+    }
+    for (int i = NAV_BAR_HEIGHT/GRID_SIZE; i < SCREEN_HEIGHT/GRID_SIZE; i++) {
+        DrawLine(0, i * GRID_SIZE, SCREEN_WIDTH, i * GRID_SIZE,
+                 (Color){70, 70, 70, 120});
+    }
+   
+    // Draw the predicted present; the confirmed past only decides the result
+    VersusState* v = VersusCurrentState();
+    if (versus.started) {
+        DrawCircle(
+            CellX(v->food) + GRID_SIZE / 2,
+            CellY(v->food) + GRID_SIZE / 2,
+            GRID_SIZE / 2 - 2,
+            (Color){ 200, 0, 0, 255 }
+        );
+       
+        Color playerColors[2] = { accentColor1, accentColor2 };
+        for (int p = 0; p < 2; p++) {
+            for (int i = 0; i < v->length[p]; i++) {
+                int cell = VersusCell(v, p, i);
+                float colorFactor = (float)i / v->length[p];
+                Color c = playerColors[p];
+                Color snakeColor = (Color){
+                    (unsigned char)(c.r * (1.0f - colorFactor * 0.5f)),
+                    (unsigned char)(c.g * (1.0f - colorFactor * 0.3f)),
+                    (unsigned char)(c.b * (1.0f - colorFactor * 0.1f)),
+                    v->alive[p] ? 255 : 120
+                };
+                DrawRectangleRounded(
+                    (Rectangle){ CellX(cell), CellY(cell), GRID_SIZE, GRID_SIZE },
+                    i == 0 ? 0.5f : 0.3f,
+                    i == 0 ? 8 : 6,
+                    snakeColor
+                );
+            }
+        }
+    }
+   
+    // Navigation bar
+    DrawRectangle(0, 0, SCREEN_WIDTH, NAV_BAR_HEIGHT, navBarColor);
+   
+    char scoreText[60];
+    sprintf(scoreText, "P1: %d  P2: %d", versus.started ? v->length[0] - 3 : 0, versus.started ? v->length[1] - 3 : 0);
+    DrawUiText(scoreText, 20, 20, 24, WHITE);
+   
+    const char* youText = versus.player == 0 ? "VERSUS - YOU ARE P1" : "VERSUS - YOU ARE P2";
+    DrawUiText(youText, SCREEN_WIDTH/2 - MeasureUiText(youText, 22)/2, 20, 22, versus.player == 0 ? accentColor1 : accentColor2);
+   
+    char rollbackText[80];
+    sprintf(rollbackText, "Rollbacks: %d (max %d)  Stalls: %d", versus.rollbacks, versus.deepestRollback, versus.stalls);
+    DrawUiText(rollbackText, SCREEN_WIDTH - MeasureUiText(rollbackText, 16) - 20, 16, 16, accentColor3);
+   
+    char linkText[80];
+    sprintf(linkText, "Link: %.0f+%.0f ms, %.1f%% loss", versus.delayMs, versus.jitterMs, versus.lossPercent);
+    DrawUiText(linkText, SCREEN_WIDTH - MeasureUiText(linkText, 16) - 20, 36, 16, (Color){180, 180, 180, 200});
+   
+    DrawUiText("Q: Menu | ESC: Quit Game", 20, 50, 16, (Color){180, 180, 180, 200});
+   
+    if (versus.desynced) {
+        DrawUiText("DESYNC", SCREEN_WIDTH - MeasureUiText("DESYNC", 16) - 20, 56, 16, phantomWallColor);
+    }
+   
+    if (!versus.started) {
+        DrawUiText("WAITING FOR OPPONENT...", SCREEN_WIDTH/2 - MeasureUiText("WAITING FOR OPPONENT...", 30)/2,
+                SCREEN_HEIGHT/2 - 15, 30, accentColor2);
+    }
+   
+    EndFrame();
+}
+
+// Golden fruit blinks during its last two seconds
+int PickupVisible(int p) {
+    return entities.pickupKind[p] != PICKUP_GOLDEN ||
+           !(entities.pickupLife[p] < 2.0f && fmodf(entities.pickupLife[p], 0.4f) < 0.2f);
+}
+
+// Apple-shaped food with natural colors
+void DrawApple(Cell cell) {
+    const int padding = 2;
+    const int appleSize = GRID_SIZE - 2 * padding;
+    const int stemHeight = 4;
+    const int stemWidth = 2;
+    const int leafWidth = 4;
+    const int leafHeight = 2;
+
+    // Define natural apple colors
+    Color appleRed = (Color){ 200, 0, 0, 255 };
+    Color stemBrown = (Color){ 101, 67, 33, 255 };
+    Color leafGreen = (Color){ 34, 139, 34, 255 };
+
+    // Apple body
+    DrawCircle(
+        CellX(cell) + GRID_SIZE / 2,
+        CellY(cell) + GRID_SIZE / 2,
+        appleSize / 2,
+        appleRed
+    );
+
+    // Stem
+    DrawRectangle(
+        CellX(cell) + GRID_SIZE / 2 - stemWidth / 2,
+        CellY(cell) + padding,
+        stemWidth,
+        stemHeight,
+        stemBrown
+    );
+
+    // Leaf
+    DrawEllipse(
+        CellX(cell) + GRID_SIZE / 2 + leafWidth / 2,
+        CellY(cell) + padding,
+        leafWidth,
+        leafHeight,
+        leafGreen
+    );
+}
+
+void DrawGoldenFruit(Cell cell) {
+    float fruitX = CellX(cell) + 2;
+    float fruitY = CellY(cell) + 2;
+    float fruitSize = GRID_SIZE - 4;
+   
+    // Draw the orange fruit with more natural shape
+    DrawRectangleRounded(
+        (Rectangle){ fruitX, fruitY, fruitSize, fruitSize },
+        0.9f,
+        16,
+        (Color){ 255, 165, 0, 255 }
+    );
+   
+    // Draw the brown stem with curve
+    float stemWidth = fruitSize * 0.2f;
+    float stemHeight = fruitSize * 0.3f;
+    DrawRectangleRounded(
+        (Rectangle){
+            fruitX + (fruitSize - stemWidth)/2,
+            fruitY - stemHeight + 2,
+            stemWidth,
+            stemHeight
+        },
+        0.8f,
+        6,
+        (Color){ 139, 69, 19, 255 }
+    );
+}
+
+void DrawSnakeSegment(Cell cell, Color color, int head, int dx, int dy) {
+    float segmentRadius = head ? 0.5f : 0.3f;
+    int segmentCorners = head ? 8 : 6;
+   
+    DrawRectangleRounded(
+        (Rectangle){CellX(cell), CellY(cell), GRID_SIZE, GRID_SIZE},
+        segmentRadius,
+        segmentCorners,
+        color
+    );
+    if (!head) return;
+   
+    // Draw eyes on the head
+    float eyeSize = GRID_SIZE * 0.2f;
+    float eyeOffset = GRID_SIZE * 0.25f;
+   
+    float eyeX1, eyeX2, eyeY1, eyeY2;
+   
+    if (dx > 0) {
+        eyeX1 = eyeX2 = CellX(cell) + GRID_SIZE - eyeSize - 2;
+        eyeY1 = CellY(cell) + eyeOffset;
+        eyeY2 = CellY(cell) + GRID_SIZE - eyeSize - eyeOffset;
+    } else if (dx < 0) {
+        eyeX1 = eyeX2 = CellX(cell) + 2;
+        eyeY1 = CellY(cell) + eyeOffset;
+        eyeY2 = CellY(cell) + GRID_SIZE - eyeSize - eyeOffset;
+    } else if (dy > 0) {
+        eyeY1 = eyeY2 = CellY(cell) + GRID_SIZE - eyeSize - 2;
+        eyeX1 = CellX(cell) + eyeOffset;
+        eyeX2 = CellX(cell) + GRID_SIZE - eyeSize - eyeOffset;
+    } else {
+        eyeY1 = eyeY2 = CellY(cell) + 2;
+        eyeX1 = CellX(cell) + eyeOffset;
+        eyeX2 = CellX(cell) + GRID_SIZE - eyeSize - eyeOffset;
+    }
+   
+    DrawRectangleRounded(
+        (Rectangle){eyeX1, eyeY1, eyeSize, eyeSize},
+        0.8f,
+        4,
+        WHITE
+    );
+   
+    DrawRectangleRounded(
+        (Rectangle){eyeX2, eyeY2, eyeSize, eyeSize},
+        0.8f,
+        4,
+        WHITE
+    );
+}
+
+// CPU fallback for the single-player board, one raylib call per shape
+void DrawGridLines() {
+    // Draw grid lines (subtle grey - more visible)
+    for (int i = 0; i < SCREEN_WIDTH/GRID_SIZE; i++) {
+        DrawLine(i * GRID_SIZE, NAV_BAR_HEIGHT, i * GRID_SIZE, SCREEN_HEIGHT,
+                 (Color){70, 70, 70, 120});
+    }
+   
+    for (int i = NAV_BAR_HEIGHT/GRID_SIZE; i < SCREEN_HEIGHT/GRID_SIZE; i++) {
+        DrawLine(0, i * GRID_SIZE, SCREEN_WIDTH, i * GRID_SIZE,
+                 (Color){70, 70, 70, 120});
+    }
+}
+
+// Maze walls never move, so they are drawn with the grid into a texture once per level
+void PrepareLevelBackground() {
+    if (currentMode != MAZE || level == NULL || levelBackgroundChecksum == level->checksum) return;
+    if (levelBackgroundChecksum == 0) levelBackground = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    levelBackgroundChecksum = level->checksum;
+   
+    BeginTextureMode(levelBackground);
+    ClearBackground(BLANK);
+    DrawRectangle(0, NAV_BAR_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT - NAV_BAR_HEIGHT, bgColor);
+    DrawGridLines();
+    for (int cell = 0; cell < BOARD_CELLS; cell++) {
+        if (!levelWalls[cell]) continue;
+        DrawRectangle(CellX(cell), CellY(cell), GRID_SIZE, GRID_SIZE, levelWallColor);
+        DrawRectangleLines(CellX(cell) + 1, CellY(cell) + 1, GRID_SIZE - 2, GRID_SIZE - 2, (Color){ 110, 130, 180, 255 });
     }
+    EndTextureMode();
+}
+
+void UnloadLevelBackground() {
+    if (levelBackgroundChecksum == 0) return;
+    UnloadRenderTexture(levelBackground);
+    levelBackgroundChecksum = 0;
+}
+
+// Draws the pre-rendered maze background; returns 0 outside Maze mode
+int DrawLevelBackground() {
+    if (currentMode != MAZE || levelBackgroundChecksum == 0) return 0;
+    // Render textures are stored upside down
+    DrawTextureRec(levelBackground.texture, (Rectangle){ 0, 0, SCREEN_WIDTH, -SCREEN_HEIGHT }, (Vector2){ 0, 0 }, WHITE);
+    return 1;
+}
+
+void DrawBoardImmediate() {
+    if (!DrawLevelBackground()) DrawGridLines();
    
-    DrawText(
-        modeText,
-        SCREEN_WIDTH/2 - MeasureText(modeText, 30)/2,
-        SCREEN_HEIGHT/2 + 100,
-        30,
-        modeColor
-    );
+    for (int p = 0; p < entities.pickupCount; p++) {
+        if (!PickupVisible(p)) continue;
+        if (entities.pickupKind[p] == PICKUP_FOOD) {
+            DrawApple(entities.pickupCell[p]);
+        } else {
+            DrawGoldenFruit(entities.pickupCell[p]);
+        }
+    }
    
-    // Get ready message
-    DrawText(
-        "Get Ready!",
-        SCREEN_WIDTH/2 - MeasureText("Get Ready!", 40)/2,
-        SCREEN_HEIGHT/2 - 150,
-        40,
-        WHITE
-    );
+    // Draw snake body
+    for (int i = 0; i < snake.length; i++) {
+        DrawSnakeSegment(SnakeCell(i), SnakeSegmentColor(i), i == 0, snake.dx, snake.dy);
+    }
    
-    EndDrawing();
+    // Draw phantom walls
+    for (int w = 0; w < entities.wallCount; w++) {
+        Cell start = entities.wallStart[w];
+        Cell end = entities.wallEnd[w];
+        DrawLineEx(
+            (Vector2){CellX(start) + GRID_SIZE/2, CellY(start) + GRID_SIZE/2},
+            (Vector2){CellX(end) + GRID_SIZE/2, CellY(end) + GRID_SIZE/2},
+            GRID_SIZE,
+            phantomWallColor
+        );
+    }
 }
 
-void RenderGame() {
-    BeginDrawing();
-    ClearBackground(bgColor);
-
+// Nav bar with score, timers and mode; redrawn by the dirty path only when hudText changes
+void DrawGameHud() {
     // Draw the navigation bar
     DrawRectangle(0, 0, SCREEN_WIDTH, NAV_BAR_HEIGHT, navBarColor);
    
     // Draw score
     char scoreText[30];
     sprintf(scoreText, "Score: %d", snake.length - 2);
-    DrawText(scoreText, 20, 20, 24, WHITE);
+    DrawUiText(scoreText, 20, 20, 24, WHITE);
    
     // Draw timer for Time Attack mode
     if (currentMode == TIME_ATTACK) {
         char timerText[30];
         sprintf(timerText, "Time: %.1f", timeAttackTimer);
-        DrawText(timerText, SCREEN_WIDTH - MeasureText(timerText, 24) - 20, 20, 24, accentColor2);
+        DrawUiText(timerText, SCREEN_WIDTH - MeasureUiText(timerText, 24) - 20, 20, 24, accentColor2);
     }
     
     // Challenge mode - display countdown until next phantom wall
-    if (currentMode == CHALLENGE && !phantomWall.active) {
-        float timeRemaining = PHANTOM_WALL_INTERVAL - phantomWallTimer;
+    if (currentMode == CHALLENGE) {
+        float timeRemaining = PhantomWallInterval() - entities.wallSpawnTimer;
         if (timeRemaining < 0) timeRemaining = 0;
 
         char wallTimerText[50];
         sprintf(wallTimerText, "Next Wall: %.1fs", timeRemaining);
-        DrawText(wallTimerText,
-                 SCREEN_WIDTH - MeasureText(wallTimerText, 20) - 20,
+        DrawUiText(wallTimerText,
+                 SCREEN_WIDTH - MeasureUiText(wallTimerText, 20) - 20,
                  20,
                  20,
                  phantomWallColor);
@@ -897,296 +6781,1398 @@ void RenderGame() {
             modeText = "INFINITE PLAY";
             modeColor = (Color){200, 200, 0, 255};
             break;
+        case MAZE:
+            modeText = "MAZE MODE";
+            modeColor = (Color){255, 170, 120, 255};
+            break;
+        case ARENA:
+            modeText = "SNAKE ARENA";
+            modeColor = (Color){215, 160, 235, 255};
+            break;
+        case VERSUS:
+            modeText = "VERSUS";
+            modeColor = phantomWallColor;
+            break;
+    }
+   
+    DrawUiText(modeText, SCREEN_WIDTH/2 - MeasureUiText(modeText, 24)/2, 20, 24, modeColor);
+   
+    // Draw controls reminder
+    DrawUiText("P: Pause | Q: Menu | ESC: Quit Game", 20, 50, 16, (Color){180, 180, 180, 200});
+}
+
+// Everything that changes every frame: wall countdowns and the pause banner
+void DrawGameOverlays() {
+    // Countdown over each phantom wall
+    for (int w = 0; w < entities.wallCount; w++) {
+        Cell start = entities.wallStart[w];
+        Cell end = entities.wallEnd[w];
+        if (entities.wallCountdown[w] > 0) {
+            char countdownText[10];
+            sprintf(countdownText, "%d", entities.wallCountdown[w]);
+           
+            float midX = (CellX(start) + CellX(end)) / 2;
+            float midY = (CellY(start) + CellY(end)) / 2;
+           
+            float pulseScale = 1.0f + 0.3f * sinf(AnimationTime() * 5.0f);
+            int fontSize = (int)(40 * pulseScale);
+           
+            DrawUiText(
+                countdownText,
+                midX - MeasureUiText(countdownText, fontSize)/2 + GRID_SIZE/2,
+                midY - fontSize/2 + GRID_SIZE/2,
+                fontSize,
+                WHITE
+            );
+        }
+    }
+   
+    if (rewinding) {
+        char rewindText[64];
+        sprintf(rewindText, "<< REWIND  %.1f s left  (%d moves, %.1f KB)", rewindMilliseconds / 1000.0f,
+                (int)(rewindLast - rewindFirst), RewindBytesUsed() / 1024.0f);
+        DrawUiText(rewindText, SCREEN_WIDTH/2 - MeasureUiText(rewindText, 20)/2, NAV_BAR_HEIGHT + 10, 20, accentColor2);
+    }
+   
+    // Draw pause indicator
+    if (paused) {
+        DrawUiText("PAUSED", SCREEN_WIDTH/2 - MeasureUiText("PAUSED", 40)/2,
+                SCREEN_HEIGHT/2 - 20, 40, WHITE);
+        DrawUiText("Press P to resume", SCREEN_WIDTH/2 - MeasureUiText("Press P to resume", 20)/2,
+                SCREEN_HEIGHT/2 + 30, 20, accentColor3);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Dirty-region rendering for machines without GPU acceleration. The frame
+// persists in a render texture and each frame only repaints the cells whose
+// look changed (new head, old tail, eaten or blinking fruit, wall cells) and
+// the nav bar when its text changed. A full repaint only happens when a game
+// starts or is resumed. Overlays that change every frame go on top of it.
+// ---------------------------------------------------------------------------
+
+void BuildCellLooks(CellLook* looks) {
+    memset(looks, 0, sizeof(CellLook) * BOARD_CELLS);
+    for (int p = 0; p < entities.pickupCount; p++) {
+        if (PickupVisible(p)) {
+            looks[entities.pickupCell[p]].kind = entities.pickupKind[p] == PICKUP_GOLDEN ? 4 : 3;
+        }
+    }
+    for (int i = snake.length - 1; i >= 0; i--) {
+        CellLook* look = &looks[SnakeCell(i)];
+        look->kind = i == 0 ? 2 : 1;
+        look->color = SnakeSegmentColor(i);
+        if (i == 0) {
+            look->dx = snake.dx;
+            look->dy = snake.dy;
+        }
+    }
+    for (int w = 0; w < entities.wallCount; w++) {
+        for (int i = 0; i < entities.wallCellCount[w]; i++) {
+            looks[entities.wallCells[w][i]].wall = 1;
+        }
+    }
+}
+
+void DrawCanvasCell(Cell cell, const CellLook* look) {
+    int x = CellX(cell);
+    int y = CellY(cell);
+    if (currentMode == MAZE && levelBackgroundChecksum != 0) {
+        // Copy the cell back from the maze background (stored upside down, like every render texture)
+        DrawTextureRec(levelBackground.texture, (Rectangle){ x, SCREEN_HEIGHT - y - GRID_SIZE, GRID_SIZE, -GRID_SIZE },
+                       (Vector2){ x, y }, WHITE);
+    } else {
+        DrawRectangle(x, y, GRID_SIZE, GRID_SIZE, bgColor);
+        DrawRectangle(x, y, GRID_SIZE, 1, (Color){70, 70, 70, 120});
+        DrawRectangle(x, y, 1, GRID_SIZE, (Color){70, 70, 70, 120});
+    }
+   
+    if (look->wall) {
+        DrawRectangle(x, y, GRID_SIZE, GRID_SIZE, phantomWallColor);
+    } else if (look->kind == 1 || look->kind == 2) {
+        DrawSnakeSegment(cell, look->color, look->kind == 2, look->dx, look->dy);
+    } else if (look->kind == 3) {
+        DrawApple(cell);
+    } else if (look->kind == 4) {
+        DrawGoldenFruit(cell);
+    }
+}
+
+void RenderGameDirty() {
+    static CellLook looks[BOARD_CELLS];
+    int fullRepaint = !canvasValid;
+    dirtyPixels = 0;
+   
+    PrepareLevelBackground();
+    BeginTextureMode(boardCanvas);
+    if (fullRepaint) {
+        ClearBackground(bgColor);
+        memset(canvasCells, 0xFF, sizeof(canvasCells));  // Matches no real look, so every cell repaints
+        canvasHud[0] = '\0';
+        canvasValid = 1;
+    }
+   
+    char hudText[sizeof(canvasHud)];
+    snprintf(hudText, sizeof(hudText), "%d %d %.1f %.1f", currentMode, snake.length, timeAttackTimer,
+             currentMode == CHALLENGE ? PhantomWallInterval() - entities.wallSpawnTimer : 0);
+    if (strcmp(hudText, canvasHud) != 0) {
+        strcpy(canvasHud, hudText);
+        DrawGameHud();
+        dirtyPixels += SCREEN_WIDTH * NAV_BAR_HEIGHT;
+    }
+   
+    BuildCellLooks(looks);
+    for (int cell = 0; cell < BOARD_CELLS; cell++) {
+        if (memcmp(&looks[cell], &canvasCells[cell], sizeof(CellLook)) == 0) continue;
+        canvasCells[cell] = looks[cell];
+        DrawCanvasCell(cell, &looks[cell]);
+        dirtyPixels += GRID_SIZE * GRID_SIZE;
+    }
+    FlushUiText();  // The nav bar text belongs to the canvas
+    EndTextureMode();
+    if (fullRepaint) dirtyPixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+   
+    // Render textures are stored upside down
+    BeginFrame();
+    DrawTextureRec(boardCanvas.texture, (Rectangle){ 0, 0, SCREEN_WIDTH, -SCREEN_HEIGHT }, (Vector2){ 0, 0 }, WHITE);
+    DrawGameOverlays();
+   
+    char statsText[64];
+    sprintf(statsText, "%d px redrawn | %.1f ms", dirtyPixels, GetFrameTime() * 1000.0f);
+    DrawUiText(statsText, SCREEN_WIDTH - MeasureUiText(statsText, 16) - 20, 55, 16, (Color){180, 180, 180, 200});
+    EndFrame();
+}
+
+void RenderGame() {
+    if (currentMode == ARENA) {
+        RenderArena();
+        return;
+    }
+    if (currentMode == VERSUS) {
+        RenderVersus();
+        return;
+    }
+    if (dirtyRedraw) {
+        RenderGameDirty();
+        return;
+    }
+   
+    PrepareLevelBackground();
+    BeginFrame();
+    ClearBackground(bgColor);
+    DrawGameHud();
+   
+    if (boardShaderReady) {
+        DrawBoardShader();
+    } else {
+        DrawBoardImmediate();
+    }
+   
+    FlushUiText();  // Particles fly over the nav bar text
+    DrawParticles();
+    DrawGameOverlays();
+   
+    EndFrame();
+}
+
+void RenderGameOver() {
+    BeginFrame();
+    ClearBackground(bgColor);
+    DrawParticles();  // The dissolving snake, behind the text
+   
+    // Title with glow effect
+    int titleSize = 60;
+    const char* title = "GAME OVER";
+   
+    // Glow effect
+    for (int i = 4; i > 0; i--) {
+        Color glowColor = (Color){200, 30, 30, 40 + 10 * i};
+        DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2 + i/2, 150 - i/2, titleSize, glowColor);
+        DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2 - i/2, 150 - i/2, titleSize, glowColor);
+    }
+   
+    // Main title
+    DrawUiText(title, SCREEN_WIDTH/2 - MeasureUiText(title, titleSize)/2, 150, titleSize, RED);
+   
+    // Score
+    char scoreText[50];
+    if (currentMode == VERSUS) {
+        VersusState* v = VersusConfirmedState();
+        int me = versus.player;
+        if (v->alive[me] == v->alive[1 - me]) {
+            sprintf(scoreText, "Draw!");
+        } else {
+            sprintf(scoreText, v->alive[me] ? "You Win!" : "You Lose!");
+        }
+    } else {
+        sprintf(scoreText, "Final Score: %d", snake.length - 2);
+    }
+    DrawUiText(
+        scoreText,
+        SCREEN_WIDTH/2 - MeasureUiText(scoreText, 40)/2,
+        SCREEN_HEIGHT/2 - 20,
+        40,
+        WHITE
+    );
+   
+    // Additional stats based on game mode
+    if (currentMode == TIME_ATTACK) {
+        char timeText[50];
+        sprintf(timeText, "Time: %.1f seconds", tuning.timeAttackDuration - timeAttackTimer);
+        DrawUiText(
+            timeText,
+            SCREEN_WIDTH/2 - MeasureUiText(timeText, 30)/2,
+            SCREEN_HEIGHT/2 + 40,
+            30,
+            accentColor2
+        );
+    } else if (currentMode == CHALLENGE) {
+        char challengeText[50];
+        sprintf(challengeText, "Challenge Mode Completed!");
+        DrawUiText(
+            challengeText,
+            SCREEN_WIDTH/2 - MeasureUiText(challengeText, 30)/2,
+            SCREEN_HEIGHT/2 + 40,
+            30,
+            accentColor3
+        );
+    }
+   
+    // Rank among every recorded run of this mode, straight from the index
+    if (lastRank > 0 && currentMode <= MAZE) {
+        const ScoreIndex* index = &leaderboards[currentMode];
+        char rankText[64];
+        sprintf(rankText, "Rank #%d of %u", lastRank, index->records);
+        DrawUiText(rankText, SCREEN_WIDTH/2 - MeasureUiText(rankText, 30)/2, SCREEN_HEIGHT/2 + 85, 30,
+                 lastRank == 1 ? accentColor3 : accentColor1);
+       
+        char topText[96] = "Top:";
+        for (int i = 0; i < index->topCount && i < 5; i++) {
+            sprintf(topText + strlen(topText), "  %d", index->top[i].score);
+        }
+        DrawUiText(topText, SCREEN_WIDTH/2 - MeasureUiText(topText, 20)/2, SCREEN_HEIGHT/2 + 125, 20,
+                 (Color){180, 180, 180, 255});
+    }
+   
+    // Return to menu instructions
+    DrawUiText(
+        "Press ENTER or SPACE to return to menu",
+        SCREEN_WIDTH/2 - MeasureUiText("Press ENTER or SPACE to return to menu", 20)/2,
+        SCREEN_HEIGHT - 100,
+        20,
+        accentColor1
+    );
+   
+    EndFrame();
+}
+
+// ---------------------------------------------------------------------------
+// Bot tournament (--tournament). Every policy plays the same seeded games in
+// every single-player mode on worker threads that steal jobs from each other
+// when they run dry. Each game's result lands in its own slot, and ratings
+// are computed afterwards in a fixed order, so a seed set always produces
+// the same report however the work was scheduled.
+// ---------------------------------------------------------------------------
+
+const int botDx[4] = { 1, 0, -1, 0 };  // Right, down, left, up, as in versus
+const int botDy[4] = { 0, 1, 0, -1 };
+
+// Cell one step from cell in direction dir, or -1 off the board
+int BotStep(const BotView* view, int cell, int dir) {
+    int x = cell % view->cols + botDx[dir];
+    int y = cell / view->cols + botDy[dir];
+    if (view->wrap) {
+        x = (x + view->cols) % view->cols;
+        y = (y + view->rows) % view->rows;
+    } else if (x < 0 || x >= view->cols || y < 0 || y >= view->rows) {
+        return -1;
+    }
+    return y * view->cols + x;
+}
+
+int BotCellFree(const BotView* view, int cell) {
+    return cell >= 0 && view->wallsAt[cell] == 0 && view->bodyAt[cell] == 0;
+}
+
+int BotDistance(const BotView* view, int a, int b) {
+    if (view->distances != NULL) return view->distances[a * view->cols * view->rows + b];
+    int dx = abs(a % view->cols - b % view->cols);
+    int dy = abs(a / view->cols - b / view->cols);
+    if (view->wrap) {
+        if (dx > view->cols / 2) dx = view->cols - dx;
+        if (dy > view->rows / 2) dy = view->rows - dy;
+    }
+    return dx + dy;
+}
+
+int BotNearestPickup(const BotView* view, int cell) {
+    int best = -1, bestDistance = 0;
+    for (int i = 0; i < view->pickupCount; i++) {
+        int distance = BotDistance(view, cell, view->pickupCells[i]);
+        if (best < 0 || distance < bestDistance) {
+            best = view->pickupCells[i];
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+int PolicyRandom(const BotView* view) {
+    int options[4], count = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        if (BotCellFree(view, BotStep(view, view->head, dir))) options[count++] = dir;
+    }
+    return count > 0 ? options[SimRandom(view->rng) % count] : 0;
+}
+
+// Safe step that gets closest to the nearest pickup
+int PolicyGreedy(const BotView* view) {
+    int target = BotNearestPickup(view, view->head);
+    int best = -1, bestDistance = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        int next = BotStep(view, view->head, dir);
+        if (!BotCellFree(view, next)) continue;
+        int distance = target >= 0 ? BotDistance(view, next, target) : 0;
+        if (best < 0 || distance < bestDistance) {
+            best = dir;
+            bestDistance = distance;
+        }
+    }
+    return best >= 0 ? best : 0;
+}
+
+// Greedy, but never into a pocket smaller than the snake
+int PolicyCautious(const BotView* view) {
+    static _Thread_local unsigned int seen[BOARD_CELLS];  // Stamped per fill, so it never needs clearing
+    static _Thread_local unsigned int stamp = 0;
+    int queue[BOARD_CELLS];
+    if (view->cols * view->rows > BOARD_CELLS) return PolicyGreedy(view);
+   
+    int target = BotNearestPickup(view, view->head);
+    int best = -1, bestRoom = 0, bestDistance = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        int next = BotStep(view, view->head, dir);
+        if (!BotCellFree(view, next)) continue;
+       
+        // Free cells reachable from next, up to enough room for the whole snake
+        stamp++;
+        int head = 0, tail = 0;
+        seen[next] = stamp;
+        queue[tail++] = next;
+        int enough = view->length + 4;
+        while (head < tail && tail < enough) {
+            int cell = queue[head++];
+            for (int d = 0; d < 4; d++) {
+                int n = BotStep(view, cell, d);
+                if (n >= 0 && seen[n] != stamp && BotCellFree(view, n)) {
+                    seen[n] = stamp;
+                    queue[tail++] = n;
+                }
+            }
+        }
+        int room = tail >= enough ? enough : tail;
+        int distance = target >= 0 ? BotDistance(view, next, target) : 0;
+        if (best < 0 || room > bestRoom || (room == bestRoom && distance < bestDistance)) {
+            best = dir;
+            bestRoom = room;
+            bestDistance = distance;
+        }
+    }
+    return best >= 0 ? best : 0;
+}
+
+// Sets up a seeded game in this thread's simulation state
+void StartBotGame(BotGame* game, BotPolicyFn policy, int mode, unsigned int seed) {
+    currentMode = (GameMode)mode;
+    gameRng = SeedRandom(seed);
+    game->policy = policy;
+    game->policyRng = SeedRandom(seed ^ 0x5BD1E995u);
+    speed = tuning.baseSpeed;
+    timeAttackTimer = tuning.timeAttackDuration;
+    running = 1;
+    paused = 0;
+    InitSnake();
+    ResetEntities();
+    SelectModeKernel();
+   
+    BotView* view = &game->view;
+    view->cols = BOARD_COLS;
+    view->rows = BOARD_ROWS;
+    view->mode = mode;
+    view->wrap = mode == INFINITE;
+    view->bodyAt = snake.bodyAt;
+    view->wallsAt = entities.wallsAt;
+    view->pickupCells = game->pickupCells;
+    view->rng = &game->policyRng;
+    view->distances = mode == MAZE ? levelDistances : NULL;
+    game->result = (BotGameResult){ 0, 0, BOT_SURVIVED };
+}
+
+// Plays one move, the step before it covering the time the move takes; returns 0 once the
+// game has ended or reached TOURNAMENT_MAX_SECONDS of game time
+int StepBotGame(BotGame* game) {
+    BotGameResult* result = &game->result;
+    if (result->seconds >= TOURNAMENT_MAX_SECONDS) return 0;
+    BotView* view = &game->view;
+    float deltaTime = speed / 1000.0f;
+    modeKernel->step(deltaTime);
+    result->seconds += deltaTime;
+    result->score = snake.length - 2;
+    if (!running) {
+        result->cause = BOT_TIME_UP;
+        return 0;
+    }
+   
+    view->head = SnakeCell(0);
+    view->dx = snake.dx;
+    view->dy = snake.dy;
+    view->length = snake.length;
+    view->pickupCount = entities.pickupCount;
+    for (int i = 0; i < entities.pickupCount; i++) game->pickupCells[i] = entities.pickupCell[i];
+    int dir = game->policy(view) & 3;
+    if (botDx[dir] != -snake.dx || botDy[dir] != -snake.dy) {
+        snake.dx = botDx[dir];
+        snake.dy = botDy[dir];
+    }
+    int heading = snake.dx == 1 ? 0 : snake.dy == 1 ? 1 : snake.dx == -1 ? 2 : 3;
+   
+    // Name the cause before the move, while the board still shows it
+    int next = BotStep(view, view->head, heading);
+    int cause = next < 0 ? BOT_HIT_EDGE : entities.wallsAt[next] ? BOT_HIT_WALL : BOT_HIT_SELF;
+    modeKernel->moveSnake();
+    result->score = snake.length - 2;
+    if (!running && modeKernel->endsOnDeath) {
+        result->cause = cause;
+        return 0;
+    }
+    running = 1;  // Infinite mode carries on
+    return 1;
+}
+
+BotGameResult PlayBotGame(BotPolicyFn policy, int mode, unsigned int seed) {
+    static _Thread_local BotGame game;
+    StartBotGame(&game, policy, mode, seed);
+    while (StepBotGame(&game)) {}
+    return game.result;
+}
+
+#ifndef _WIN32
+
+// Jobs left in each worker's range, packed as begin << 32 | end
+atomic_ullong tournamentRanges[TOURNAMENT_MAX_WORKERS];
+int tournamentWorkers = 0;
+
+// Next job for worker self: the front of its own range, else the back half of someone else's
+int TakeTournamentJob(int self) {
+    for (;;) {
+        unsigned long long range = atomic_load(&tournamentRanges[self]);
+        unsigned int begin = range >> 32, end = (unsigned int)range;
+        if (begin >= end) break;
+        if (atomic_compare_exchange_weak(&tournamentRanges[self], &range, (unsigned long long)(begin + 1) << 32 | end)) {
+            return begin;
+        }
+    }
+    for (int k = 1; k < tournamentWorkers; k++) {
+        int victim = (self + k) % tournamentWorkers;
+        unsigned long long range = atomic_load(&tournamentRanges[victim]);
+        unsigned int begin = range >> 32, end = (unsigned int)range;
+        while (begin < end) {
+            unsigned int middle = begin + (end - begin) / 2;
+            if (atomic_compare_exchange_weak(&tournamentRanges[victim], &range, (unsigned long long)begin << 32 | middle)) {
+                atomic_store(&tournamentRanges[self], (unsigned long long)(middle + 1) << 32 | end);
+                return middle;
+            }
+            begin = range >> 32;
+            end = (unsigned int)range;
+        }
+    }
+    return -1;
+}
+
+void* TournamentWorkerMain(void* arg) {
+    int self = (int)(size_t)arg;
+    TraceThreadName("tournament");
+    tuning = playTuning;
+    for (int job; (job = TakeTournamentJob(self)) >= 0; ) {
+        int policy = job % tournament.policyCount;
+        int seed = job / tournament.policyCount % tournament.seeds;
+        int mode = job / tournament.policyCount / tournament.seeds;
+        double traceStart = TraceBegin();
+        tournament.results[job] = PlayBotGame(tournament.policies[policy].choose, mode, seed + 1);
+        TraceSpan("PlayBotGame", traceStart, "score", tournament.results[job].score);
+    }
+    return NULL;
+}
+
+// Spreads jobs over one worker per core, the calling thread included; returns the seconds they took
+double RunTournamentJobs(int jobs, void* (*workerMain)(void*)) {
+    tournamentWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (tournamentWorkers < 1) tournamentWorkers = 1;
+    if (tournamentWorkers > TOURNAMENT_MAX_WORKERS) tournamentWorkers = TOURNAMENT_MAX_WORKERS;
+    for (int w = 0; w < tournamentWorkers; w++) {
+        unsigned long long begin = (unsigned long long)jobs * w / tournamentWorkers;
+        unsigned long long end = (unsigned long long)jobs * (w + 1) / tournamentWorkers;
+        atomic_store(&tournamentRanges[w], begin << 32 | end);
+    }
+   
+    struct timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[TOURNAMENT_MAX_WORKERS];
+    for (int w = 1; w < tournamentWorkers; w++) {
+        pthread_create(&threads[w], NULL, workerMain, (void*)(size_t)w);
+    }
+    workerMain((void*)0);
+    for (int w = 1; w < tournamentWorkers; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    return (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int CompareInts(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+int AddTournamentPolicy(const char* name) {
+    static const BotPolicy builtIn[] = {
+        { "random", PolicyRandom },
+        { "greedy", PolicyGreedy },
+        { "cautious", PolicyCautious }
+    };
+    if (tournament.policyCount >= TOURNAMENT_MAX_POLICIES) return 0;
+    for (int i = 0; i < (int)(sizeof(builtIn) / sizeof(builtIn[0])); i++) {
+        if (strcmp(name, builtIn[i].name) == 0) {
+            tournament.policies[tournament.policyCount++] = builtIn[i];
+            return 1;
+        }
+    }
+   
+    // Anything else is a shared library exporting int SnakePolicy(const BotView*)
+    void* library = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+    BotPolicyFn choose = library != NULL ? (BotPolicyFn)dlsym(library, "SnakePolicy") : NULL;
+    if (choose == NULL) {
+        fprintf(stderr, "Unknown policy %s (%s)\n", name, library == NULL ? dlerror() : "no SnakePolicy symbol");
+        return 0;
+    }
+    const char* slash = strrchr(name, '/');
+    tournament.policies[tournament.policyCount].name = slash != NULL ? slash + 1 : name;
+    tournament.policies[tournament.policyCount].choose = choose;
+    tournament.policyCount++;
+    return 1;
+}
+
+int RunTournament(int seeds, int policyCount, char** policyNames) {
+    static const char* modeNames[] = { "Classic", "Time Attack", "Challenge", "Infinite", "Maze" };
+    static const char* causeNames[] = { "edge", "self", "wall", "time", "alive" };
+    if (policyCount == 0) {
+        static char* defaults[] = { "random", "greedy", "cautious" };
+        policyNames = defaults;
+        policyCount = 3;
+    }
+    for (int i = 0; i < policyCount; i++) {
+        if (!AddTournamentPolicy(policyNames[i])) return 1;
+    }
+    if (!LoadLevel(levelPath)) {
+        fprintf(stderr, "Could not load level %s\n", levelPath);
+        return 1;
+    }
+    tournament.seeds = seeds > 0 ? seeds : 1;
+    int jobs = TOURNAMENT_MODES * tournament.seeds * tournament.policyCount;
+    tournament.results = calloc(jobs, sizeof(BotGameResult));
+    if (tournament.results == NULL) return 1;
+    double seconds = RunTournamentJobs(jobs, TournamentWorkerMain);
+   
+    // Per policy and mode: score percentiles, survival and how games ended
+    int* scores = malloc(tournament.seeds * sizeof(int));
+    printf("%-12s %-12s %7s %5s %5s %5s %5s %8s  deaths\n", "policy", "mode", "mean", "p10", "p50", "p90", "max", "survive");
+    for (int p = 0; p < tournament.policyCount; p++) {
+        for (int mode = 0; mode < TOURNAMENT_MODES; mode++) {
+            double total = 0, survived = 0;
+            int causes[BOT_CAUSE_COUNT] = { 0 };
+            for (int seed = 0; seed < tournament.seeds; seed++) {
+                BotGameResult* r = &tournament.results[(mode * tournament.seeds + seed) * tournament.policyCount + p];
+                scores[seed] = r->score;
+                total += r->score;
+                survived += r->seconds;
+                causes[r->cause]++;
+            }
+            qsort(scores, tournament.seeds, sizeof(int), CompareInts);
+            printf("%-12s %-12s %7.2f %5d %5d %5d %5d %7.1fs ", tournament.policies[p].name, modeNames[mode],
+                   total / tournament.seeds, scores[tournament.seeds / 10], scores[tournament.seeds / 2],
+                   scores[tournament.seeds * 9 / 10], scores[tournament.seeds - 1], survived / tournament.seeds);
+            for (int c = 0; c < BOT_CAUSE_COUNT; c++) {
+                if (causes[c] > 0) printf(" %s %d", causeNames[c], causes[c]);
+            }
+            printf("\n");
+        }
     }
+    free(scores);
    
-    DrawText(modeText, SCREEN_WIDTH/2 - MeasureText(modeText, 24)/2, 20, 24, modeColor);
+    // Elo from every pairing on every seed: the longer snake wins, then the longer survivor
+    double elo[TOURNAMENT_MAX_POLICIES];
+    for (int p = 0; p < tournament.policyCount; p++) elo[p] = 1500;
+    long matches = 0;
+    for (int game = 0; game < TOURNAMENT_MODES * tournament.seeds; game++) {
+        BotGameResult* r = &tournament.results[game * tournament.policyCount];
+        for (int a = 0; a < tournament.policyCount; a++) {
+            for (int b = a + 1; b < tournament.policyCount; b++) {
+                double outcome = 0.5;
+                if (r[a].score != r[b].score) outcome = r[a].score > r[b].score;
+                else if (r[a].seconds != r[b].seconds) outcome = r[a].seconds > r[b].seconds;
+                double expected = 1.0 / (1.0 + pow(10.0, (elo[b] - elo[a]) / 400.0));
+                elo[a] += TOURNAMENT_ELO_K * (outcome - expected);
+                elo[b] -= TOURNAMENT_ELO_K * (outcome - expected);
+                matches++;
+            }
+        }
+    }
+    printf("\n%-12s %6s\n", "policy", "elo");
+    for (int p = 0; p < tournament.policyCount; p++) {
+        printf("%-12s %6.0f\n", tournament.policies[p].name, elo[p]);
+    }
+    printf("\n%d games (%ld pairings) in %.2f s on %d threads: %.0f games/s, %.0f matches/s\n",
+           jobs, matches, seconds, tournamentWorkers, jobs / seconds, matches / seconds);
+    free(tournament.results);
+    return 0;
+}
+
+#else
+
+int RunTournament(int seeds, int policyCount, char** policyNames) {
+    fprintf(stderr, "The tournament runner needs POSIX threads and is not available on this platform\n");
+    return 1;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Difficulty sweep (--sweep). One bot policy plays the same seeded games in
+// one mode under every combination of the given tuning values, on the
+// tournament's work-stealing workers. Each setting only keeps histograms of
+// its results, so memory stays flat however many games are played, and the
+// report reads the same whatever order the games finished in.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+void* SweepWorkerMain(void* arg) {
+    int self = (int)(size_t)arg;
+    TraceThreadName("sweep");
+    for (int job; (job = TakeTournamentJob(self)) >= 0; ) {
+        int setting = job / sweep.games;
+        tuning = sweep.settings[setting];
+        BotGameResult result = PlayBotGame(sweep.policy, sweep.mode, job % sweep.games + 1);
+       
+        SweepTally* tally = &sweep.tallies[setting];
+        int second = (int)result.seconds;
+        if (second >= SWEEP_SECONDS) second = SWEEP_SECONDS - 1;
+        atomic_fetch_add_explicit(&tally->scores[ClampScore(result.score)], 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&tally->seconds[second], 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&tally->causes[result.cause], 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+// name=v1,v2,... adds an axis to the grid
+int AddSweepAxis(const char* spec) {
+    const char* equals = strchr(spec, '=');
+    Tuning scratch = playTuning;
+    if (sweep.axisCount >= SWEEP_MAX_AXES || equals == NULL || equals - spec >= 32) return 0;
+    char* name = sweep.axisNames[sweep.axisCount];
+    memcpy(name, spec, equals - spec);
+    name[equals - spec] = '\0';
    
-    // Draw pause indicator
-    if (paused) {
-        DrawText("PAUSED", SCREEN_WIDTH/2 - MeasureText("PAUSED", 40)/2,
-                SCREEN_HEIGHT/2 - 20, 40, WHITE);
-        DrawText("Press P to resume", SCREEN_WIDTH/2 - MeasureText("Press P to resume", 20)/2,
-                SCREEN_HEIGHT/2 + 30, 20, accentColor3);
+    int count = 0;
+    for (const char* value = equals + 1; *value != '\0' && count < SWEEP_MAX_VALUES; ) {
+        char* end;
+        float v = strtof(value, &end);
+        if (end == value || !SetTuning(&scratch, name, v) || !TuningInBounds(&scratch)) return 0;
+        sweep.axisValues[sweep.axisCount][count++] = v;
+        value = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return 0;
+    }
+    if (count == 0) return 0;
+    sweep.valueCounts[sweep.axisCount++] = count;
+    return 1;
+}
+
+// Value index of axis a in setting s
+int SweepValueIndex(int s, int a) {
+    for (int later = sweep.axisCount - 1; later > a; later--) s /= sweep.valueCounts[later];
+    return s % sweep.valueCounts[a];
+}
+
+// Smallest score that at least fraction of the games reached or beat
+int SweepPercentile(const SweepTally* tally, int games, double fraction) {
+    long seen = 0;
+    for (int score = 0; score <= LEADERBOARD_MAX_SCORE; score++) {
+        seen += atomic_load(&tally->scores[score]);
+        if (seen > games * fraction) return score;
+    }
+    return LEADERBOARD_MAX_SCORE;
+}
+
+int RunSweep(int games, const char* modeName, const char* policyName, int axisCount, char** axes) {
+    static const char* modeArgs[] = { "classic", "time-attack", "challenge", "infinite", "maze" };
+    static const char* causeNames[] = { "edge", "self", "wall", "time", "alive" };
+    static const int curveSeconds[] = { 10, 30, 60, 120, 300 };
+    sweep.mode = -1;
+    for (int mode = 0; mode <= MAZE; mode++) {
+        if (strcmp(modeName, modeArgs[mode]) == 0) sweep.mode = mode;
+    }
+    if (sweep.mode < 0) {
+        fprintf(stderr, "Unknown mode %s; expected classic, time-attack, challenge, infinite or maze\n", modeName);
+        return 1;
+    }
+    if (!AddTournamentPolicy(policyName)) return 1;
+    sweep.policy = tournament.policies[tournament.policyCount - 1].choose;
+    if (sweep.mode == MAZE && !LoadLevel(levelPath)) {
+        fprintf(stderr, "Could not load level %s\n", levelPath);
+        return 1;
     }
    
-    // Draw grid lines (subtle grey - more visible)
-    for (int i = 0; i < SCREEN_WIDTH/GRID_SIZE; i++) {
-        DrawLine(i * GRID_SIZE, NAV_BAR_HEIGHT, i * GRID_SIZE, SCREEN_HEIGHT,
-                 (Color){70, 70, 70, 120});
+    sweep.settingCount = 1;
+    for (int i = 0; i < axisCount; i++) {
+        if (!AddSweepAxis(axes[i])) {
+            fprintf(stderr, "Bad sweep axis %s; expected name=v1,v2,... with a known name and values in range\n", axes[i]);
+            return 1;
+        }
+        sweep.settingCount *= sweep.valueCounts[i];
+        if (sweep.settingCount > SWEEP_MAX_SETTINGS) {
+            fprintf(stderr, "Sweep grid is larger than %d settings\n", SWEEP_MAX_SETTINGS);
+            return 1;
+        }
+    }
+    sweep.games = games > 0 ? games : 1;
+    if ((long long)sweep.games * sweep.settingCount > INT_MAX) {
+        fprintf(stderr, "Too many games in one sweep\n");
+        return 1;
     }
    
-    for (int i = NAV_BAR_HEIGHT/GRID_SIZE; i < SCREEN_HEIGHT/GRID_SIZE; i++) {
-        DrawLine(0, i * GRID_SIZE, SCREEN_WIDTH, i * GRID_SIZE,
-                 (Color){70, 70, 70, 120});
+    // Every setting starts from the --tune knobs, then takes its values from the grid
+    sweep.settings = malloc(sweep.settingCount * sizeof(Tuning));
+    sweep.tallies = calloc(sweep.settingCount, sizeof(SweepTally));
+    if (sweep.settings == NULL || sweep.tallies == NULL) return 1;
+    for (int s = 0; s < sweep.settingCount; s++) {
+        sweep.settings[s] = playTuning;
+        for (int a = 0; a < sweep.axisCount; a++) {
+            SetTuning(&sweep.settings[s], sweep.axisNames[a], sweep.axisValues[a][SweepValueIndex(s, a)]);
+        }
     }
    
-    // Draw apple-shaped food with natural colors
-    const int padding = 2;
-    const int appleSize = GRID_SIZE - 2 * padding;
-    const int stemHeight = 4;
-    const int stemWidth = 2;
-    const int leafWidth = 4;
-    const int leafHeight = 2;
+    int jobs = sweep.games * sweep.settingCount;
+    double seconds = RunTournamentJobs(jobs, SweepWorkerMain);
+   
+    // One row per setting: scores, the share of games still going at each point of the curve, and endings
+    for (int a = 0; a < sweep.axisCount; a++) printf("%13s ", sweep.axisNames[a]);
+    printf("%7s %5s %5s %5s %5s", "mean", "p10", "p50", "p90", "max");
+    for (int i = 0; i < (int)(sizeof(curveSeconds) / sizeof(curveSeconds[0])); i++) printf(" %5ds", curveSeconds[i]);
+    printf("  endings\n");
+    for (int s = 0; s < sweep.settingCount; s++) {
+        SweepTally* tally = &sweep.tallies[s];
+        for (int a = 0; a < sweep.axisCount; a++) printf("%13g ", sweep.axisValues[a][SweepValueIndex(s, a)]);
+       
+        double total = 0;
+        int best = 0;
+        for (int score = 0; score <= LEADERBOARD_MAX_SCORE; score++) {
+            int count = atomic_load(&tally->scores[score]);
+            total += (double)score * count;
+            if (count > 0) best = score;
+        }
+        printf("%7.2f %5d %5d %5d %5d", total / sweep.games, SweepPercentile(tally, sweep.games, 0.1),
+               SweepPercentile(tally, sweep.games, 0.5), SweepPercentile(tally, sweep.games, 0.9), best);
+       
+        for (int i = 0; i < (int)(sizeof(curveSeconds) / sizeof(curveSeconds[0])); i++) {
+            long alive = 0;
+            for (int second = curveSeconds[i]; second < SWEEP_SECONDS; second++) alive += atomic_load(&tally->seconds[second]);
+            printf(" %5.1f%%", 100.0 * alive / sweep.games);
+        }
+        printf(" ");
+        for (int c = 0; c < BOT_CAUSE_COUNT; c++) {
+            int count = atomic_load(&tally->causes[c]);
+            if (count > 0) printf(" %s %.1f%%", causeNames[c], 100.0 * count / sweep.games);
+        }
+        printf("\n");
+    }
+    printf("\n%d settings x %d games of %s by %s in %.2f s on %d threads: %.0f games/s\n",
+           sweep.settingCount, sweep.games, modeArgs[sweep.mode], policyName, seconds, tournamentWorkers, jobs / seconds);
+    free(sweep.settings);
+    free(sweep.tallies);
+    return 0;
+}
 
-    // Define natural apple colors
-    Color appleRed = (Color){ 200, 0, 0, 255 };
-    Color stemBrown = (Color){ 101, 67, 33, 255 };
-    Color leafGreen = (Color){ 34, 139, 34, 255 };
+#else
 
-    // Apple body
-    DrawCircle(
-        food.x + GRID_SIZE / 2,
-        food.y + GRID_SIZE / 2,
-        appleSize / 2,
-        appleRed
-    );
+int RunSweep(int games, const char* modeName, const char* policyName, int axisCount, char** axes) {
+    fprintf(stderr, "The difficulty sweep needs POSIX threads and is not available on this platform\n");
+    return 1;
+}
 
-    // Stem
-    DrawRectangle(
-        food.x + GRID_SIZE / 2 - stemWidth / 2,
-        food.y + padding,
-        stemWidth,
-        stemHeight,
-        stemBrown
-    );
+#endif
 
-    // Leaf
-    DrawEllipse(
-        food.x + GRID_SIZE / 2 + leafWidth / 2,
-        food.y + padding,
-        leafWidth,
-        leafHeight,
-        leafGreen
-    );
+// ---------------------------------------------------------------------------
+// Spectator wall (--spectate): a grid of live bot games on one screen. Each
+// game is played in real time on its own thread, in that thread's copy of
+// the simulation state, and publishes a frame after every move. The main
+// thread only draws: when a game has published since its tile was last
+// drawn, the frame is loaded into the main thread's state and drawn with the
+// in-game HUD and board code, scaled down, into the game's render texture.
+// Tiles of games that did not move are shown as they are.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+void PublishSpectatorFrame(int index, int over) {
+    SpectatorGame* game = &spectatorGames[index];
+    pthread_mutex_lock(&spectatorLocks[index]);
+    SpectatorFrame* frame = &game->frame;
+    frame->mode = currentMode;
+    frame->length = snake.length;
+    frame->dx = snake.dx;
+    frame->dy = snake.dy;
+    frame->timeAttackTimer = timeAttackTimer;
+    frame->over = over;
+    frame->entities = entities;
+    for (int i = 0; i < snake.length; i++) {
+        frame->body[i] = SnakeCell(i);
+    }
+    pthread_mutex_unlock(&spectatorLocks[index]);
+    atomic_fetch_add_explicit(&game->generation, 1, memory_order_release);
+}
+
+// Sleeps until the monotonic clock reaches *deadline, then moves it on by seconds
+void SpectatorWait(struct timespec* deadline, double seconds) {
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL);
+    long nanoseconds = deadline->tv_nsec + (long)(seconds * 1e9);
+    deadline->tv_sec += nanoseconds / 1000000000L;
+    deadline->tv_nsec = nanoseconds % 1000000000L;
+}
+
+void* SpectatorWorkerMain(void* arg) {
+    int self = (int)(size_t)arg;
+    SpectatorGame* game = &spectatorGames[self];
+    static _Thread_local BotGame bot;
+    TraceThreadName("spectator");
+    tuning = playTuning;
    
-    // Draw golden fruit if active
-    if (goldenActive) {
-        Color goldenColor = (Color){255, 165, 0, 255};
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    while (!atomic_load(&spectatorStop)) {
+        StartBotGame(&bot, tournament.policies[game->policy].choose, game->mode, game->seed);
+        PublishSpectatorFrame(self, 0);
        
-        float fruitX = goldenFruit.x + 2;
-        float fruitY = goldenFruit.y + 2;
-        float fruitSize = GRID_SIZE - 4;
+        int playing = 1;
+        while (playing && !atomic_load(&spectatorStop)) {
+            SpectatorWait(&deadline, speed / 1000.0);
+            double traceStart = TraceBegin();
+            playing = StepBotGame(&bot);
+            PublishSpectatorFrame(self, !playing);
+            TraceSpan("SpectatorMove", traceStart, "length", snake.length);
+        }
+        for (int i = 0; i < (int)(SPECTATOR_GAME_OVER_SECONDS * 10) && !atomic_load(&spectatorStop); i++) {
+            SpectatorWait(&deadline, 0.1);
+        }
+        game->seed += spectatorCount;
+    }
+    return NULL;
+}
+
+// Loads a published frame into this thread's state, where the drawing code reads it
+void ShowSpectatorFrame(const SpectatorFrame* frame) {
+    currentMode = (GameMode)frame->mode;
+    ClearSnakeBody();
+    for (int i = frame->length - 1; i >= 0; i--) {
+        PushSnakeHead(frame->body[i]);
+    }
+    snake.dx = frame->dx;
+    snake.dy = frame->dy;
+    timeAttackTimer = frame->timeAttackTimer;
+    entities = frame->entities;
+}
+
+void DrawSpectatorTile(SpectatorGame* game, const SpectatorFrame* frame, float scale) {
+    BeginTextureMode(game->tile);
+    ClearBackground(bgColor);
+    Camera2D camera = { 0 };
+    camera.zoom = scale;
+    BeginMode2D(camera);
+    DrawGameHud();
+    DrawBoardImmediate();
+    if (frame->over) {
+        DrawRectangle(0, NAV_BAR_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT - NAV_BAR_HEIGHT, (Color){ 0, 0, 0, 150 });
+        DrawUiText("GAME OVER", SCREEN_WIDTH/2 - MeasureUiText("GAME OVER", 100)/2, SCREEN_HEIGHT/2 - 50, 100, RED);
+    }
+    FlushUiText();
+    EndMode2D();
+    EndTextureMode();
+}
+
+int RunSpectatorWall(int games, int policyCount, char** policyNames) {
+    if (games < 1) games = 1;
+    if (games > SPECTATOR_MAX_GAMES) games = SPECTATOR_MAX_GAMES;
+    if (policyCount == 0) {
+        static char* defaults[] = { "random", "greedy", "cautious" };
+        policyNames = defaults;
+        policyCount = 3;
+    }
+    for (int i = 0; i < policyCount; i++) {
+        if (!AddTournamentPolicy(policyNames[i])) return 1;
+    }
+    if (!LoadLevel(levelPath)) {
+        fprintf(stderr, "Could not load level %s\n", levelPath);
+        return 1;
+    }
+    spectatorGames = calloc(games, sizeof(SpectatorGame));
+    if (spectatorGames == NULL) return 1;
+    spectatorCount = games;
    
-        // Draw the orange fruit with more natural shape
-        DrawRectangleRounded(
-            (Rectangle){ fruitX, fruitY, fruitSize, fruitSize },
-            0.9f,
-            16,
-            (Color){ 255, 165, 0, 255 }
-        );
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Snakescape Spectator");
+    SetTargetFPS(60);
+    LoadUiFont();
    
-        // Draw the brown stem with curve
-        float stemWidth = fruitSize * 0.2f;
-        float stemHeight = fruitSize * 0.3f;
-        DrawRectangleRounded(
-            (Rectangle){
-                fruitX + (fruitSize - stemWidth)/2,
-                fruitY - stemHeight + 2,
-                stemWidth,
-                stemHeight
-            },
-            0.8f,
-            6,
-            (Color){ 139, 69, 19, 255 }
-        );
+    // As square a grid as fits, every tile keeping the game's aspect ratio
+    int cols = (int)ceilf(sqrtf((float)games));
+    int rows = (games + cols - 1) / cols;
+    float cellWidth = (float)SCREEN_WIDTH / cols;
+    float cellHeight = (float)(SCREEN_HEIGHT - SPECTATOR_STATUS_HEIGHT) / rows;
+    float scale = fminf(cellWidth / SCREEN_WIDTH, cellHeight / SCREEN_HEIGHT);
+    int tileWidth = (int)(SCREEN_WIDTH * scale);
+    int tileHeight = (int)(SCREEN_HEIGHT * scale);
+   
+    // Policies vary fastest, so neighbouring tiles compare policies in the same mode
+    currentMode = MAZE;
+    PrepareLevelBackground();
+    for (int i = 0; i < games; i++) {
+        SpectatorGame* game = &spectatorGames[i];
+        game->policy = i % tournament.policyCount;
+        game->mode = i / tournament.policyCount % TOURNAMENT_MODES;
+        game->seed = i + 1;
+        game->drawnGeneration = -1;
+        game->tile = LoadRenderTexture(tileWidth, tileHeight);
+        pthread_mutex_init(&spectatorLocks[i], NULL);
+    }
+    for (int i = 0; i < games; i++) {
+        pthread_create(&spectatorThreads[i], NULL, SpectatorWorkerMain, (void*)(size_t)i);
     }
    
-    // Draw snake body
-    for (int i = 0; i < snake.length; i++) {
-        // Calculate color gradient from head to tail
-        float colorFactor = (float)i / snake.length;
-        Color snakeColor;
-       
-        if (currentMode == CLASSIC) {
-            snakeColor = (Color){
-                (unsigned char)(accentColor1.r * (1.0f - colorFactor * 0.5f)),
-                (unsigned char)(accentColor1.g * (1.0f - colorFactor * 0.3f)),
-                (unsigned char)(accentColor1.b * (1.0f - colorFactor * 0.1f)),
-                255
-            };
-        } else if (currentMode == TIME_ATTACK) {
-            snakeColor = (Color){
-                (unsigned char)(accentColor2.r * (1.0f - colorFactor * 0.5f)),
-                (unsigned char)(accentColor2.g * (1.0f - colorFactor * 0.3f)),
-                (unsigned char)(accentColor2.b * (1.0f - colorFactor * 0.1f)),
-                255
-            };
-        } else {
-            snakeColor = (Color){
-                (unsigned char)(accentColor3.r * (1.0f - colorFactor * 0.5f)),
-                (unsigned char)(accentColor3.g * (1.0f - colorFactor * 0.3f)),
-                (unsigned char)(accentColor3.b * (1.0f - colorFactor * 0.1f)),
-                255
-            };
-        }
-       
-        // Draw segment
-        float segmentRadius = i == 0 ? 0.5f : 0.3f;
-        int segmentCorners = i == 0 ? 8 : 6;
-       
-        DrawRectangleRounded(
-            (Rectangle){snake.body[i].x, snake.body[i].y, GRID_SIZE, GRID_SIZE},
-            segmentRadius,
-            segmentCorners,
-            snakeColor
-        );
+    static SpectatorFrame frame;
+    int redraws = 0, redrawsPerSecond = 0;
+    double secondStart = GetTime();
+    while (!WindowShouldClose()) {
+        double traceStart = TraceBegin();
+        int frameRedraws = 0;
+        for (int i = 0; i < games; i++) {
+            SpectatorGame* game = &spectatorGames[i];
+            int generation = atomic_load_explicit(&game->generation, memory_order_acquire);
+            if (generation == game->drawnGeneration) continue;
+            pthread_mutex_lock(&spectatorLocks[i]);
+            frame = game->frame;
+            pthread_mutex_unlock(&spectatorLocks[i]);
+            game->drawnGeneration = generation;
+            game->score = frame.length - 2;
+            ShowSpectatorFrame(&frame);
+            DrawSpectatorTile(game, &frame, scale);
+            frameRedraws++;
+        }
+        redraws += frameRedraws;
+        TraceSpan("SpectatorTiles", traceStart, "redraws", frameRedraws);
+        if (GetTime() - secondStart >= 1.0) {
+            redrawsPerSecond = redraws;
+            redraws = 0;
+            secondStart = GetTime();
+        }
        
-        // Draw eyes on the head
-        if (i == 0) {
-            float eyeSize = GRID_SIZE * 0.2f;
-            float eyeOffset = GRID_SIZE * 0.25f;
-           
-            float eyeX1, eyeX2, eyeY1, eyeY2;
-           
-            if (snake.dx > 0) {
-                eyeX1 = eyeX2 = snake.body[0].x + GRID_SIZE - eyeSize - 2;
-                eyeY1 = snake.body[0].y + eyeOffset;
-                eyeY2 = snake.body[0].y + GRID_SIZE - eyeSize - eyeOffset;
-            } else if (snake.dx < 0) {
-                eyeX1 = eyeX2 = snake.body[0].x + 2;
-                eyeY1 = snake.body[0].y + eyeOffset;
-                eyeY2 = snake.body[0].y + GRID_SIZE - eyeSize - eyeOffset;
-            } else if (snake.dy > 0) {
-                eyeY1 = eyeY2 = snake.body[0].y + GRID_SIZE - eyeSize - 2;
-                eyeX1 = snake.body[0].x + eyeOffset;
-                eyeX2 = snake.body[0].x + GRID_SIZE - eyeSize - eyeOffset;
-            } else {
-                eyeY1 = eyeY2 = snake.body[0].y + 2;
-                eyeX1 = snake.body[0].x + eyeOffset;
-                eyeX2 = snake.body[0].x + GRID_SIZE - eyeSize - eyeOffset;
-            }
-           
-            DrawRectangleRounded(
-                (Rectangle){eyeX1, eyeY1, eyeSize, eyeSize},
-                0.8f,
-                4,
-                WHITE
-            );
+        BeginFrame();
+        ClearBackground(menuBgColor);
+        for (int i = 0; i < games; i++) {
+            SpectatorGame* game = &spectatorGames[i];
+            int x = (int)((i % cols) * cellWidth + (cellWidth - tileWidth) / 2);
+            int y = (int)((i / cols) * cellHeight + (cellHeight - tileHeight) / 2);
+            // Render textures are stored upside down
+            DrawTextureRec(game->tile.texture, (Rectangle){ 0, 0, tileWidth, -tileHeight }, (Vector2){ x, y }, WHITE);
            
-            DrawRectangleRounded(
-                (Rectangle){eyeX2, eyeY2, eyeSize, eyeSize},
-                0.8f,
-                4,
-                WHITE
-            );
+            char label[64];
+            snprintf(label, sizeof(label), "%s  %s  %d", tournament.policies[game->policy].name, menuOptions[game->mode], game->score);
+            DrawUiText(label, x + 2, y + tileHeight - 11, 10, (Color){ 220, 220, 220, 255 });
         }
+       
+        char status[96];
+        sprintf(status, "%d games | %d tile redraws/s | %d FPS", games, redrawsPerSecond, GetFPS());
+        DrawUiText(status, 10, SCREEN_HEIGHT - SPECTATOR_STATUS_HEIGHT + 4, 16, accentColor2);
+        EndFrame();
     }
    
-    // Draw phantom wall if active
-    if (phantomWall.active) {
-        DrawLineEx(
-            (Vector2){phantomWall.start.x + GRID_SIZE/2, phantomWall.start.y + GRID_SIZE/2},
-            (Vector2){phantomWall.end.x + GRID_SIZE/2, phantomWall.end.y + GRID_SIZE/2},
-            GRID_SIZE,
-            phantomWallColor
-        );
+    atomic_store(&spectatorStop, 1);
+    for (int i = 0; i < games; i++) {
+        pthread_join(spectatorThreads[i], NULL);
+        pthread_mutex_destroy(&spectatorLocks[i]);
+        UnloadRenderTexture(spectatorGames[i].tile);
+    }
+    UnloadLevelBackground();
+    UnloadUiFont();
+    free(spectatorGames);
+    CloseWindow();
+    return 0;
+}
+
+#else
+
+int RunSpectatorWall(int games, int policyCount, char** policyNames) {
+    fprintf(stderr, "The spectator wall needs POSIX threads and is not available on this platform\n");
+    return 1;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Offline replay rendering: re-simulates a recorded game as fast as the
+// machine allows and draws each output frame with the same render functions
+// the game uses, into an offscreen target. PNG compression or YUV conversion
+// runs on a pool of encoder threads; the main thread writes frames in order.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+void* ReplayWorkerMain(void* unused) {
+    (void)unused;
+    TraceThreadName("replay encoder");
+    for (;;) {
+        int frame = atomic_fetch_add(&replayNextJob, 1);
+        ReplaySlot* slot = &replaySlots[frame % REPLAY_SLOTS];
+        while (atomic_load_explicit(&slot->state, memory_order_acquire) != REPLAY_SLOT_FILLED ||
+               atomic_load_explicit(&slot->frame, memory_order_relaxed) != frame) {
+            if (atomic_load(&replayFinished) && frame >= atomic_load(&replayQueued)) return NULL;
+            usleep(100);
+        }
        
-        if (phantomWall.countdown > 0) {
-            char countdownText[10];
-            sprintf(countdownText, "%d", phantomWall.countdown);
-           
-            float midX = (phantomWall.start.x + phantomWall.end.x) / 2;
-            float midY = (phantomWall.start.y + phantomWall.end.y) / 2;
-           
-            float pulseScale = 1.0f + 0.3f * sinf(GetTime() * 5.0f);
-            int fontSize = (int)(40 * pulseScale);
-           
-            DrawText(
-                countdownText,
-                midX - MeasureText(countdownText, fontSize)/2 + GRID_SIZE/2,
-                midY - fontSize/2 + GRID_SIZE/2,
-                fontSize,
-                WHITE
-            );
+        double traceStart = TraceBegin();
+        if (replayPng) {
+            char fileName[256];
+            snprintf(fileName, sizeof(fileName), "%s_%05d.png", replayOutput, frame);
+            ImageFlipVertical(&slot->image);
+            ExportImage(slot->image, fileName);
+        } else {
+            ConvertToY4m(slot->image, slot->planes);
         }
+        TraceSpan("EncodeFrame", traceStart, "frame", frame);
+        atomic_store_explicit(&slot->state, REPLAY_SLOT_ENCODED, memory_order_release);
     }
-   
-    // Draw controls reminder
-    DrawText("P: Pause | Q: Menu | ESC: Quit Game", 20, 50, 16, (Color){180, 180, 180, 200});
-   
-    EndDrawing();
 }
 
-void RenderGameOver() {
-    BeginDrawing();
-    ClearBackground(bgColor);
+// Writes encoded frames in order and frees their slots; returns the frames written so far
+int DrainReplaySlots(FILE* video, int written) {
+    while (written < atomic_load(&replayQueued)) {
+        ReplaySlot* slot = &replaySlots[written % REPLAY_SLOTS];
+        if (atomic_load_explicit(&slot->state, memory_order_acquire) != REPLAY_SLOT_ENCODED) break;
+        if (video != NULL) {
+            fputs("FRAME\n", video);
+            fwrite(slot->planes, 1, SCREEN_WIDTH * SCREEN_HEIGHT * 3 / 2, video);
+        }
+        UnloadImage(slot->image);
+        atomic_store_explicit(&slot->state, REPLAY_SLOT_FREE, memory_order_release);
+        written++;
+    }
+    return written;
+}
+
+void QueueReplayFrame(FILE* video, int* written) {
+    int frame = atomic_load(&replayQueued);
+    ReplaySlot* slot = &replaySlots[frame % REPLAY_SLOTS];
+    while (atomic_load_explicit(&slot->state, memory_order_acquire) != REPLAY_SLOT_FREE) {
+        *written = DrainReplaySlots(video, *written);
+        if (atomic_load_explicit(&slot->state, memory_order_acquire) != REPLAY_SLOT_FREE) usleep(100);
+    }
    
-    // Title with glow effect
-    int titleSize = 60;
-    const char* title = "GAME OVER";
+    slot->image = LoadImageFromTexture(offlineTarget.texture);
+    atomic_store_explicit(&slot->frame, frame, memory_order_relaxed);
+    atomic_store_explicit(&slot->state, REPLAY_SLOT_FILLED, memory_order_release);
+    atomic_store(&replayQueued, frame + 1);
+}
+
+int RunReplayRender(const char* path, const char* output, int fps) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open replay %s\n", path);
+        return 1;
+    }
+    replayPlayback = 1;
+    ReplayHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "SNKR", 4) != 0 ||
+        header.version != REPLAY_VERSION || !RestoreGameSnapshot(&header.start)) {
+        fprintf(stderr, "%s is not a replay this build can play\n", path);
+        fclose(file);
+        return 1;
+    }
    
-    // Glow effect
-    for (int i = 4; i > 0; i--) {
-        Color glowColor = (Color){200, 30, 30, 40 + 10 * i};
-        DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2 + i/2, 150 - i/2, titleSize, glowColor);
-        DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2 - i/2, 150 - i/2, titleSize, glowColor);
+    // A .y4m name gets one video stream, anything else is a prefix for numbered PNGs
+    size_t length = strlen(output);
+    replayPng = !(length > 4 && strcmp(output + length - 4, ".y4m") == 0);
+    replayOutput = output;
+    FILE* video = NULL;
+    if (!replayPng) {
+        video = fopen(output, "wb");
+        if (video == NULL) {
+            fprintf(stderr, "Could not create %s\n", output);
+            fclose(file);
+            return 1;
+        }
+        fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", SCREEN_WIDTH, SCREEN_HEIGHT, fps);
     }
    
-    // Main title
-    DrawText(title, SCREEN_WIDTH/2 - MeasureText(title, titleSize)/2, 150, titleSize, RED);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Snake Game");
+    InitBoardRenderer();
+    LoadUiFont();
+    offlineTarget = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    currentState = GAME;
    
-    // Score
-    char scoreText[50];
-    sprintf(scoreText, "Final Score: %d", snake.length - 2);
-    DrawText(
-        scoreText,
-        SCREEN_WIDTH/2 - MeasureText(scoreText, 40)/2,
-        SCREEN_HEIGHT/2 - 20,
-        40,
-        WHITE
-    );
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;  // The main thread keeps one core for itself
+    if (workers < 1) workers = 1;
+    if (workers > REPLAY_MAX_WORKERS) workers = REPLAY_MAX_WORKERS;
+    for (int i = 0; i < REPLAY_SLOTS; i++) {
+        atomic_store(&replaySlots[i].state, REPLAY_SLOT_FREE);
+        atomic_store(&replaySlots[i].frame, -1);
+        replaySlots[i].planes = video != NULL ? malloc(SCREEN_WIDTH * SCREEN_HEIGHT * 3 / 2) : NULL;
+    }
+    pthread_t threads[REPLAY_MAX_WORKERS];
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&threads[i], NULL, ReplayWorkerMain, NULL);
+    }
    
-    // Additional stats based on game mode
-    if (currentMode == TIME_ATTACK) {
-        char timeText[50];
-        sprintf(timeText, "Time: %.1f seconds", TIME_ATTACK_DURATION - timeAttackTimer);
-        DrawText(
-            timeText,
-            SCREEN_WIDTH/2 - MeasureText(timeText, 30)/2,
-            SCREEN_HEIGHT/2 + 40,
-            30,
-            accentColor2
-        );
-    } else if (currentMode == CHALLENGE) {
-        char challengeText[50];
-        sprintf(challengeText, "Challenge Mode Completed!");
-        DrawText(
-            challengeText,
-            SCREEN_WIDTH/2 - MeasureText(challengeText, 30)/2,
-            SCREEN_HEIGHT/2 + 40,
-            30,
-            accentColor3
-        );
+    double start = GetTime();
+    double frameLength = 1.0 / fps;
+    double simTime = 0;
+    int frames = 0;
+    int written = 0;
+    int gameOverFrames = 2 * fps;  // The dissolve and final score, as the player saw them
+    int ended = 0;
+    while (!ended) {
+        // Feed recorded frames until the simulation reaches the end of this output frame
+        double frameEnd = (frames + 1) * frameLength;
+        while (currentState == GAME && simTime < frameEnd) {
+            ReplayFrame input;
+            if (fread(&input, sizeof(input), 1, file) != 1) {
+                ended = 1;
+                break;
+            }
+            snake.dx = input.dx;
+            snake.dy = input.dy;
+            paused = input.paused;
+            rewinding = input.rewinding;
+            UpdateGame(input.deltaTime);
+            if (!(currentState == GAME && paused)) {
+                UpdateParticles(input.deltaTime);
+            }
+            simTime += input.deltaTime;
+        }
+        if (ended) break;
+       
+        offlineClock = frameEnd;
+        if (currentState == GAME) {
+            RenderGame();
+        } else {
+            if (gameOverFrames-- <= 0) break;
+            UpdateParticles((float)frameLength);
+            RenderGameOver();
+        }
+        QueueReplayFrame(video, &written);
+        frames++;
     }
    
-    // Return to menu instructions
-    DrawText(
-        "Press ENTER or SPACE to return to menu",
-        SCREEN_WIDTH/2 - MeasureText("Press ENTER or SPACE to return to menu", 20)/2,
-        SCREEN_HEIGHT - 100,
-        20,
-        accentColor1
-    );
+    atomic_store(&replayFinished, 1);
+    while (written < frames) {
+        written = DrainReplaySlots(video, written);
+        if (written < frames) usleep(100);
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = GetTime() - start;
+    printf("Rendered %d frames (%.1f s of play) in %.2f s: %.0f frames/s on %d encoder threads\n",
+           frames, frames * frameLength, seconds, frames / (seconds > 0 ? seconds : 1), workers);
    
-    EndDrawing();
+    for (int i = 0; i < REPLAY_SLOTS; i++) {
+        free(replaySlots[i].planes);
+    }
+    UnloadRenderTexture(offlineTarget);
+    UnloadBoardRenderer();
+    UnloadUiFont();
+    UnloadLevelBackground();
+    CloseWindow();
+    if (video != NULL) fclose(video);
+    fclose(file);
+    return 0;
+}
+
+#else
+
+int RunReplayRender(const char* path, const char* output, int fps) {
+    fprintf(stderr, "Replay rendering needs POSIX threads and is not available on this platform\n");
+    return 1;
 }
 
-int main() {
+#endif
+
+// ---------------------------------------------------------------------------
+// Startup: the front page only needs the window, buttons and UI font, so the
+// board shader, audio device and redraw canvas wait until a game first starts.
+// Milestones are timed from main() and logged with the first frame.
+// ---------------------------------------------------------------------------
+
+void StartupMark(const char* name) {
+    if (startupMarks == STARTUP_MAX_MARKS) return;
+    startupNames[startupMarks] = name;
+    startupTimes[startupMarks] = (MonotonicSeconds() - startupStart) * 1000.0;
+    startupMarks++;
+}
+
+void ReportStartup() {
+    char line[256];
+    int length = snprintf(line, sizeof(line), "Startup to first %s frame:", gameStateNames[currentState]);
+    double previous = 0;
+    for (int i = 0; i < startupMarks && length < (int)sizeof(line); i++) {
+        length += snprintf(line + length, sizeof(line) - length, "%s %s %.3f ms", i > 0 ? "," : "",
+                           startupNames[i], startupTimes[i] - previous);
+        previous = startupTimes[i];
+    }
+    TraceLog(previous > STARTUP_TARGET_MS ? LOG_WARNING : LOG_INFO, "%s (%.3f ms total, %s launch, target %.0f ms)",
+             line, previous, uiFontBuilt ? "cold" : "warm", STARTUP_TARGET_MS);
+}
+
+// Creates what a state draws with the first time it is entered
+void PrepareStateResources(GameState state) {
+    if (state < COUNTDOWN || gameResourcesReady) return;
+    double start = GetTime();
+    double traceStart = TraceBegin();
+    InitBoardRenderer();
+    InitGameAudio();
+    if (dirtyRedraw) {
+        boardCanvas = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    gameResourcesReady = 1;
+    TraceSpan("PrepareGame", traceStart, "state", state);
+    TraceLog(LOG_INFO, "Prepared game resources in %.3f ms", (GetTime() - start) * 1000.0);
+}
+
+int main(int argc, char* argv[]) {
+    startupStart = MonotonicSeconds();
+   
+    // Rendering options may come anywhere; strip them so the entry points below see the rest
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dirty-redraw") == 0) {
+            dirtyRedraw = 1;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            StartTracing(argv[++i]);
+        } else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+            captureFormat = strcmp(argv[++i], "png") == 0 ? CAPTURE_PNG_SEQUENCE : CAPTURE_Y4M;
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            levelPath = argv[++i];
+        } else if (strcmp(argv[i], "--tune") == 0 && i + 1 < argc) {
+            if (!ParseTuning(&playTuning, argv[++i])) return 1;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            replayDir = argv[++i];
+        } else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc) {
+            uiFontPath = argv[++i];
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+   
+    // Headless entry points
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        return RunArenaServer(argc > 2 ? atoi(argv[2]) : NET_DEFAULT_PORT);
+    }
+    if (argc > 2 && strcmp(argv[1], "--bots") == 0) {
+        return RunArenaBots(atoi(argv[2]), argc > 3 ? argv[3] : "127.0.0.1",
+                            argc > 4 ? atoi(argv[4]) : NET_DEFAULT_PORT);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return RunBenchmark(argc > 2 ? atol(argv[2]) : 1000000);
+    }
+    if (argc > 1 && strcmp(argv[1], "--tournament") == 0) {
+        return RunTournament(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? argc - 3 : 0, argv + 3);
+    }
+    if (argc > 1 && strcmp(argv[1], "--sweep") == 0) {
+        return RunSweep(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? argv[3] : "challenge",
+                        argc > 4 ? argv[4] : "cautious", argc > 5 ? argc - 5 : 0, argv + 5);
+    }
+    if (argc > 1 && strcmp(argv[1], "--spectate") == 0) {
+        return RunSpectatorWall(argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? argc - 3 : 0, argv + 3);
+    }
+    if (argc > 1 && strcmp(argv[1], "--leaderboard") == 0) {
+        return PrintLeaderboards();
+    }
+    if (argc > 3 && strcmp(argv[1], "--build-level") == 0) {
+        return BuildLevelFromText(argv[2], argv[3]);
+    }
+    if (argc > 2 && strcmp(argv[1], "--render-replay") == 0) {
+        int fps = argc > 4 ? atoi(argv[4]) : 60;
+        return RunReplayRender(argv[2], argc > 3 ? argv[3] : "replay.y4m", fps > 0 ? fps : 60);
+    }
+   
     // Initialize window and game
+    double traceStart = TraceBegin();
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Snake Game");
+    TraceSpan("InitWindow", traceStart, NULL, 0);
+    StartupMark("window");
 
     SetTargetFPS(60);
    
     // Initialize random seed
-    srand(time(NULL));
+    gameRng = SeedRandom((unsigned int)time(NULL));
+    captureSession = (long)time(NULL);
    
-    // Initialize game components
+    // Initialize game components; the rest waits for the first game (PrepareStateResources)
     InitButtons();
+    LoadUiFont();
+    StartupMark("font");
     InitSnake();
-    SpawnFood();
+    ResetEntities();
+    SelectModeKernel();
+   
+    // Pick up an interrupted game where it was left, paused
+    if (argc == 1 && LoadGameSnapshot()) {
+        currentState = GAME;
+        StartReplayRecording();
+    }
+   
+    // Join a networked match straight away when asked to
+    if (argc > 4 && strcmp(argv[1], "--versus") == 0) {
+        if (VersusConnect(atoi(argv[2]), argv[3], atoi(argv[4]),
+                          argc > 5 ? atof(argv[5]) : 0, argc > 6 ? atof(argv[6]) : 0, argc > 7 ? atof(argv[7]) : 0)) {
+            selectedMode = currentMode = VERSUS;
+            currentState = GAME;
+        } else {
+            fprintf(stderr, "Could not open versus link to %s:%s\n", argv[3], argv[4]);
+        }
+    }
+    if (argc > 2 && strcmp(argv[1], "--connect") == 0) {
+        if (NetConnect(argv[2], argc > 3 ? atoi(argv[3]) : NET_DEFAULT_PORT)) {
+            selectedMode = currentMode = ARENA;
+            currentState = GAME;
+        } else {
+            fprintf(stderr, "Could not reach arena server %s\n", argv[2]);
+        }
+    }
+    if (argc > 1 && strcmp(argv[1], "--coop") == 0) {
+        coopPlayers = argc > 2 ? atoi(argv[2]) : 2;
+        if (coopPlayers < 1) coopPlayers = 1;
+        if (coopPlayers > COOP_MAX_PLAYERS) coopPlayers = COOP_MAX_PLAYERS;
+        selectedMode = ARENA;
+        ResetGame();
+        currentState = GAME;
+        if (!StartInputThread()) {
+            fprintf(stderr, "No X11 keymap access, sampling keys once per frame\n");
+        }
+    }
    
     // Main game loop
+    PrepareStateResources(currentState);
+    GameState tracedState = currentState;
     while (!WindowShouldClose()) {
+        double frameStart = TraceBegin();
         float deltaTime = GetFrameTime();
        
         // Handle input based on game state
@@ -1208,8 +8194,24 @@ int main() {
                 HandleGameOverInput();
                 break;
         }
+        TraceSpan("Update", frameStart, "state", currentState);
+       
+        double phaseStart = TraceBegin();
+        if (!(currentState == GAME && paused)) {
+            UpdateParticles(deltaTime);
+        }
+        UpdateGameAudio();
+        HandleCaptureInput();
+        TraceSpan("Effects", phaseStart, "particles", particles.count);
+       
+        if (currentState != tracedState) {
+            TraceInstant(gameStateNames[currentState], "from", tracedState);
+            tracedState = currentState;
+        }
+        PrepareStateResources(currentState);
        
         // Render current game state
+        phaseStart = TraceBegin();
         switch (currentState) {
             case FRONT_PAGE:
                 RenderFrontPage();
@@ -1227,9 +8229,32 @@ int main() {
                 RenderGameOver();
                 break;
         }
+        TraceSpan("Render", phaseStart, NULL, 0);
+        TraceSpan("Frame", frameStart, NULL, 0);
+       
+        if (!startupReported) {
+            StartupMark("first frame");
+            ReportStartup();
+            startupReported = 1;
+        }
     }
    
-    // Close window and clean up
+    // Close window and clean up; the window close button and ESC both land here
+    if (currentState == GAME) {
+        SaveGameSnapshot();
+    }
+    StopReplayRecording();
+    NetDisconnect();
+    VersusDisconnect();
+    StopInputThread();
+    CloseGameAudio();
+    UnloadCapture();
+    UnloadBoardRenderer();
+    UnloadLevelBackground();
+    UnloadUiFont();
+    if (dirtyRedraw && gameResourcesReady) {
+        UnloadRenderTexture(boardCanvas);
+    }
     CloseWindow();
    
     return 0;